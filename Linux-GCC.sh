@@ -0,0 +1,28 @@
+#!/bin/sh
+set -e
+
+WARNINGS_FLAGS="-Wall -Wextra -Wpedantic -Wsign-conversion -Wsuggest-override"
+# BUILD_FLAGS="-std=c++20 $WARNINGS_FLAGS -O0 -g3 -fno-exceptions -fno-rtti"
+BUILD_FLAGS="-s -std=c++20 $WARNINGS_FLAGS -O3 -g0 -fno-exceptions -fno-rtti -DNDEBUG"
+
+DEFINES=
+INCLUDES=-ISources
+LIBS_PATH=
+LIBS="-ldl -pthread"
+
+# - Build Steps
+
+BUILD_PATH=Build
+
+mkdir -p $BUILD_PATH
+
+g++ $BUILD_FLAGS $DEFINES $INCLUDES $LIBS_PATH -o $BUILD_PATH/GenerateTBS Sources/GenerateTBS.cpp $LIBS
+# g++ $BUILD_FLAGS $DEFINES $INCLUDES $LIBS_PATH -o tests Sources/Tests.cpp $LIBS
+
+$BUILD_PATH/GenerateTBS
+rm -f $BUILD_PATH/GenerateTBS
+
+# Run as "Linux-GCC.sh benchmarks" to also build the benchmark suite, see Sources/Benchmarks.cpp for its options.
+if [ "$1" = "benchmarks" ]; then
+    g++ $BUILD_FLAGS $DEFINES $INCLUDES $LIBS_PATH -o $BUILD_PATH/benchmarks Sources/Benchmarks.cpp $LIBS
+fi
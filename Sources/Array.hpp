@@ -0,0 +1,120 @@
+// ======================================================================================================= //
+//      This file is part of Trauma Build System (https://github.com/FoxLeader/TraumaBuildSystem)          //
+//      Copyright: PolyTrauma Studios Srls, All Rights Reserved.                                           //
+//                                                                                                         //
+//      Author: Fabiano Raffaelli                                                                          //
+//                                                                                                         //
+// ======================================================================================================= //
+//      This software is licensed under Creative Commons (CC BY NC 4.0): See LICENSE.md for details.       //
+// ======================================================================================================= //
+
+#pragma once
+
+#include <cstdlib>
+#include <new>
+
+using size_t = decltype(sizeof(0)); static_assert(sizeof(size_t) == 8);
+
+
+
+namespace TraumaBuildSystem
+{
+    // A growable, heap allocated array. Elements are moved when the storage grows, so pointers to them are not stable.
+    template <typename T>
+    class Array
+    {
+        // ============================================================ Constructors / Destructors / Operators
+
+        public:
+
+        Array() = default;
+        Array(const Array&) = delete;
+        Array(Array&& other)                                            { *this = static_cast<Array&&>(other); }
+        ~Array()                                                        { clear(); free(mData); }
+
+        Array&                          operator=(const Array&) = delete;
+        Array&                          operator=(Array&& other)
+        {
+            if (this == &other)
+                return *this;
+
+            clear();
+            free(mData);
+            mData = other.mData;
+            mSize = other.mSize;
+            mCapacity = other.mCapacity;
+            other.mData = nullptr;
+            other.mSize = 0;
+            other.mCapacity = 0;
+            return *this;
+        }
+
+        T&                              operator[](size_t index)        { return mData[index]; }
+        const T&                        operator[](size_t index) const  { return mData[index]; }
+
+        // ============================================================ Functions
+
+        public:
+
+        T&                              push(const T& value)            { reserve(mSize + 1); return *new (mData + mSize++) T(value); }
+        T&                              push(T&& value)                 { reserve(mSize + 1); return *new (mData + mSize++) T(static_cast<T&&>(value)); }
+        void                            pop()                           { mData[--mSize].~T(); }
+
+        void                            append(const T* values, size_t count)
+        {
+            reserve(mSize + count);
+            for (size_t i = 0; i < count; i++)
+                new (mData + mSize + i) T(values[i]);
+            mSize += count;
+        }
+
+        void                            reserve(size_t capacity)
+        {
+            if (capacity <= mCapacity)
+                return;
+
+            size_t newCapacity = mCapacity < 8 ? 8 : mCapacity * 2;
+            while (newCapacity < capacity)
+                newCapacity *= 2;
+
+            auto newData = static_cast<T*>(malloc(newCapacity * sizeof(T)));
+            for (size_t i = 0; i < mSize; i++)
+            {
+                new (newData + i) T(static_cast<T&&>(mData[i]));
+                mData[i].~T();
+            }
+            free(mData);
+            mData = newData;
+            mCapacity = newCapacity;
+        }
+
+        void                            clear()
+        {
+            for (size_t i = 0; i < mSize; i++)
+                mData[i].~T();
+            mSize = 0;
+        }
+
+        size_t                          size() const                    { return mSize; }
+        bool                            is_empty() const                { return mSize == 0; }
+
+        T*                              data()                          { return mData; }
+        const T*                        data() const                    { return mData; }
+
+        T&                              back()                          { return mData[mSize - 1]; }
+        const T&                        back() const                    { return mData[mSize - 1]; }
+
+        T*                              begin()                         { return mData; }
+        T*                              end()                           { return mData + mSize; }
+        const T*                        begin() const                   { return mData; }
+        const T*                        end() const                     { return mData + mSize; }
+
+        // ============================================================ Data
+
+        private:
+
+        T*                              mData                           = nullptr;
+        size_t                          mSize                           = 0;
+        size_t                          mCapacity                       = 0;
+    };
+}
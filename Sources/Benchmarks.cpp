@@ -0,0 +1,341 @@
+// ======================================================================================================= //
+//      This file is part of Trauma Build System (https://github.com/FoxLeader/TraumaBuildSystem)          //
+//      Copyright: PolyTrauma Studios Srls, All Rights Reserved.                                           //
+//                                                                                                         //
+//      Author: Fabiano Raffaelli                                                                          //
+//                                                                                                         //
+// ======================================================================================================= //
+//      This software is licensed under Creative Commons (CC BY NC 4.0): See LICENSE.md for details.       //
+// ======================================================================================================= //
+
+#include "TraumaBuildSystem.hpp"
+
+TRAUMA_BUILD_SYSTEM(v1::Experimental)
+
+/*  Usage: benchmarks [--filter <text>] [--repetitions <count>] [--files <count>] [--scripts <count>] [--runner <build executable>] [--work <directory>]
+
+    Every benchmark runs once to warm up, then --repetitions times. Each result is printed to stdout on its own line as a JSON object,
+    so that runs can be stored and compared to spot regressions; progress goes to stderr. Times are per iteration, what an iteration
+    is depends on the benchmark: one expression for strings and paths, one file for the file system, one script for the runner.
+
+    - string, smallstring, path: in memory helpers, on paths of realistic length.
+    - fs: ForEachFile() and Exists() over a synthetic tree of --files files (1000 per directory), with and without the file system cache.
+      The tree is created in --work the first time and reused as long as the file count doesn't change.
+    - runner: the runner over --scripts empty scripts, compiling all of them (full) and finding them up to date (no-op).
+      Needs --runner, pointing to a build executable with TraumaBuildSystem and TraumaBuildSystem.gch next to it.
+*/
+
+struct Options
+{
+    const char*                     filter                          = "";
+    size_t                          repetitions                     = 5;
+    size_t                          files                           = 10000;
+    size_t                          scripts                         = 16;
+    const char*                     runner                          = nullptr;
+    const char*                     work                            = "Build/Benchmarks";
+};
+
+Options gOptions;
+
+// Results are accumulated here, so the compiler can't drop the work being measured.
+volatile size_t gSink = 0;
+
+// Inputs go through volatile pointers, so that expressions on them can't be folded at compile time.
+const char* volatile gRoot = "Sources/Engine/Runtime";
+const char* volatile gLongPath = "Sources/Engine/Runtime/Renderer/Private/Passes/PostProcess/Bloom/Implementation/Vulkan/Descriptors/BloomDownsampleDescriptorSetLayout.generated.cpp";
+
+bool Selected(const char* name)
+{
+    return strstr(name, gOptions.filter) != nullptr;
+}
+
+// fn performs the work and returns how many iterations it did. setup runs before each repetition, outside the measured time.
+void Measure(const char* name, auto&& setup, auto&& fn)
+{
+    if (!Selected(name))
+        return;
+
+    fprintf(stderr, "%s...\n", name);
+    setup();
+    fn();
+
+    uint64 best = static_cast<uint64>(-1);
+    uint64 total = 0;
+    size_t iterations = 0;
+    for (size_t i = 0; i < gOptions.repetitions; i++)
+    {
+        setup();
+        uint64 start = TraumaBuildSystem::Helpers::MonotonicTime();
+        iterations = fn();
+        uint64 elapsed = TraumaBuildSystem::Helpers::MonotonicTime() - start;
+        best = elapsed < best ? elapsed : best;
+        total += elapsed;
+    }
+
+    double perIteration = iterations > 0 ? static_cast<double>(iterations) : 1.0;
+    printf("{\"benchmark\":\"%s\",\"iterations\":%zu,\"repetitions\":%zu,\"best_ns_per_iteration\":%.2f,\"mean_ns_per_iteration\":%.2f,\"best_total_ms\":%.3f}\n",
+        name, iterations, gOptions.repetitions,
+        static_cast<double>(best) / perIteration,
+        static_cast<double>(total) / static_cast<double>(gOptions.repetitions) / perIteration,
+        static_cast<double>(best) / 1e6);
+    fflush(stdout);
+}
+
+void Measure(const char* name, auto&& fn)
+{
+    Measure(name, [] {}, fn);
+}
+
+void Skip(const char* name, const char* reason)
+{
+    if (Selected(name))
+        printf("{\"benchmark\":\"%s\",\"skipped\":\"%s\"}\n", name, reason);
+}
+
+
+
+void StringBenchmarks()
+{
+    constexpr size_t Iterations = 1000000;
+
+    Measure("string/concat", []
+    {
+        String<64> root;
+        root = gRoot;
+        for (size_t i = 0; i < Iterations; i++)
+        {
+            auto path = root / "Renderer" / "Private" * "-O2" + ".cpp";
+            gSink = gSink + Length(path);
+        }
+        return Iterations;
+    });
+
+    Measure("smallstring/concat", []
+    {
+        SmallString root(gRoot);
+        for (size_t i = 0; i < Iterations; i++)
+        {
+            auto path = root / "Renderer" / "Private" * "-O2" + ".cpp";
+            gSink = gSink + Length(path);
+        }
+        return Iterations;
+    });
+
+    Measure("string/find-last-of", []
+    {
+        String<256> path;
+        path = gLongPath;
+        for (size_t i = 0; i < Iterations; i++)
+            gSink = gSink + FindLastOf(path, "\\/") + FindLastOf(path, ".");
+        return Iterations;
+    });
+
+    // What ToWinPath() does, on every platform.
+    Measure("string/replace-separators", []
+    {
+        String<256> path;
+        path = gLongPath;
+        for (size_t i = 0; i < Iterations; i++)
+        {
+            String<256> winPath = path;
+            winPath.replace('/', '\\');
+            gSink = gSink + static_cast<size_t>(winPath[i % winPath.length()]);
+        }
+        return Iterations;
+    });
+
+    Measure("string/strip-helpers", []
+    {
+        String<256> path;
+        path = gLongPath;
+        for (size_t i = 0; i < Iterations; i++)
+            gSink = gSink + Length(StripExtension(path)) + Length(StripFileName(path)) + Length(StripPath(path)) + Length(ExtensionOf(path));
+        return Iterations;
+    });
+
+    Measure("path/build", []
+    {
+        for (size_t i = 0; i < Iterations; i++)
+        {
+            Path path(gRoot);
+            path /= "Renderer/Private";
+            path /= "Bloom.generated.cpp";
+            gSink = gSink + path.component_count() + strlen(path.extension());
+        }
+        return Iterations;
+    });
+
+    Measure("path/helpers", []
+    {
+        Path path(gLongPath);
+        for (size_t i = 0; i < Iterations; i++)
+            gSink = gSink + StripExtension(path).length() + StripFileName(path).length() + StripPath(path).length() + ExtensionOf(path).length();
+        return Iterations;
+    });
+}
+
+
+
+void FileSystemBenchmarks()
+{
+    if (!Selected("fs/"))
+        return;
+
+    constexpr size_t FilesPerDirectory = 1000;
+    size_t directoryCount = (gOptions.files + FilesPerDirectory - 1) / FilesPerDirectory;
+    SmallString tree = SmallString(gOptions.work) / "Tree";
+    char name[64];
+
+    // The tree is only rebuilt when the requested size changes, creating a million files takes a while.
+    SmallString countFile = tree / "Count";
+    snprintf(name, sizeof(name), "%zu", gOptions.files);
+    auto [storedCount, storedCountSize] = ReadFile(countFile);
+    bool reuse = storedCount && strcmp(storedCount, name) == 0;
+    free(storedCount);
+    if (!reuse)
+    {
+        fprintf(stderr, "Creating %zu files in %s...\n", gOptions.files, tree.c_str());
+        DeleteDirectory(tree);
+        for (size_t i = 0; i < gOptions.files; i++)
+        {
+            snprintf(name, sizeof(name), "/D%04zu", i / FilesPerDirectory);
+            SmallString directory = tree + name;
+            if (i % FilesPerDirectory == 0)
+                CreateDirectory(directory);
+
+            snprintf(name, sizeof(name), "/File%06zu.cpp", i);
+            if (FILE* f = fopen(directory + name, "wb"))
+                fclose(f);
+        }
+
+        if (FILE* f = fopen(countFile, "wb"))
+        {
+            fprintf(f, "%zu", gOptions.files);
+            fclose(f);
+        }
+    }
+
+    auto ForEachDirectory = [&] (auto&& fn)
+    {
+        for (size_t i = 0; i < directoryCount; i++)
+        {
+            snprintf(name, sizeof(name), "/D%04zu", i);
+            fn(tree + name);
+        }
+    };
+
+    auto ListFiles = [&]
+    {
+        size_t count = 0;
+        ForEachDirectory([&] (const SmallString& directory) { ForEachFile(directory / "*.cpp", [&] (const auto&) { count++; }); });
+        return count;
+    };
+
+    auto CheckFiles = [&]
+    {
+        size_t count = 0;
+        ForEachDirectory([&] (const SmallString& directory)
+        {
+            char fileName[64];
+            for (size_t i = 0; i < FilesPerDirectory && count < gOptions.files; i++)
+            {
+                snprintf(fileName, sizeof(fileName), "/File%06zu.cpp", count);
+                if (Exists(directory + fileName))
+                    count++;
+            }
+        });
+        return count;
+    };
+
+    Measure("fs/for-each-file", ListFiles);
+    Measure("fs/exists", CheckFiles);
+
+    EnableFileSystemCache();
+    Measure("fs/for-each-file-cached", ListFiles);
+    Measure("fs/exists-cached", CheckFiles);
+    EnableFileSystemCache(false);
+}
+
+
+
+void RunnerBenchmarks()
+{
+    if (!Selected("runner/"))
+        return;
+
+    if (!gOptions.runner || NotExists(gOptions.runner))
+    {
+        Skip("runner/full", "--runner not set");
+        Skip("runner/no-op", "--runner not set");
+        return;
+    }
+
+    // The runner keeps its cache in ../Builds, relative to the project.
+    SmallString project = SmallString(gOptions.work) / "Project";
+    SmallString scriptsDirectory = project / "BuildScripts";
+    SmallString cache = SmallString(gOptions.work) / "Builds";
+    SmallString log = SmallString(gOptions.work) / "Runner.log";
+    SmallString runnerDirectory = StripFileName(SmallString(gOptions.runner));
+
+    DeleteDirectory(project);
+    CreateDirectory(scriptsDirectory);
+    CopyFile(runnerDirectory / "TraumaBuildSystem", scriptsDirectory / "TraumaBuildSystem");
+    CopyFile(runnerDirectory / "TraumaBuildSystem.gch", scriptsDirectory / "TraumaBuildSystem.gch");
+
+    char name[64];
+    for (size_t i = 0; i < gOptions.scripts; i++)
+    {
+        snprintf(name, sizeof(name), "/Script%04zu.build", i);
+        if (FILE* f = fopen(scriptsDirectory + name, "wb"))
+        {
+            fprintf(f, "#include \"TraumaBuildSystem\"\nTRAUMA_BUILD_SYSTEM(v1::Experimental)\nBUILD_STEPS() { Println(\"%zu\"); }\n", i);
+            fclose(f);
+        }
+    }
+
+    // The runner inherits the working directory, so project doesn't need to be made absolute.
+    CommandLine cmd(gOptions.runner);
+    cmd.add(project);
+    auto Run = [&]
+    {
+        TraumaBuildSystem::Platform::RunProcess(cmd, log);
+        return gOptions.scripts;
+    };
+
+    Measure("runner/full", [&] { DeleteDirectory(cache); }, Run);
+    Measure("runner/no-op", Run);
+}
+
+
+
+int main(int argc, char** argv)
+{
+    for (int i = 1; i + 1 < argc; i += 2)
+    {
+        if (strcmp(argv[i], "--filter") == 0)
+            gOptions.filter = argv[i + 1];
+        else if (strcmp(argv[i], "--repetitions") == 0)
+            gOptions.repetitions = strtoull(argv[i + 1], nullptr, 10);
+        else if (strcmp(argv[i], "--files") == 0)
+            gOptions.files = strtoull(argv[i + 1], nullptr, 10);
+        else if (strcmp(argv[i], "--scripts") == 0)
+            gOptions.scripts = strtoull(argv[i + 1], nullptr, 10);
+        else if (strcmp(argv[i], "--runner") == 0)
+            gOptions.runner = argv[i + 1];
+        else if (strcmp(argv[i], "--work") == 0)
+            gOptions.work = argv[i + 1];
+        else
+        {
+            fprintf(stderr, "Unknown option %s\n", argv[i]);
+            return 1;
+        }
+    }
+    if (gOptions.repetitions == 0)
+        gOptions.repetitions = 1;
+
+    CreateDirectory(gOptions.work);
+
+    StringBenchmarks();
+    FileSystemBenchmarks();
+    RunnerBenchmarks();
+}
@@ -0,0 +1,37 @@
+// ======================================================================================================= //
+//      This file is part of Trauma Build System (https://github.com/FoxLeader/TraumaBuildSystem)          //
+//      Copyright: PolyTrauma Studios Srls, All Rights Reserved.                                           //
+//                                                                                                         //
+//      Author: Fabiano Raffaelli                                                                          //
+//                                                                                                         //
+// ======================================================================================================= //
+//      This software is licensed under Creative Commons (CC BY NC 4.0): See LICENSE.md for details.       //
+// ======================================================================================================= //
+
+#pragma once
+
+#include "String.hpp"
+
+// Shared by the runner and GenerateTBS, so that the precompiled header is built with the exact flags used for scripts.
+
+// Edit  Me --->
+
+StaticString buildsDir              = "../Builds";
+StaticString cacheDir               = buildsDir / ".cache";
+StaticString buildScriptsDir        = "BuildScripts";
+StaticString additionalFlags        = "-Wall -Wextra -Wpedantic -Wsign-conversion ";
+
+// <--- Edit Me
+
+StaticString compiler               = "g++";
+// -Winvalid-pch reports a TraumaBuildSystem.gch that doesn't match these flags, instead of silently ignoring it.
+StaticString commonScriptFlags      = "-s -std=c++20 -shared" * additionalFlags * "-Winvalid-pch -fdiagnostics-color=always -fno-rtti -fno-exceptions";
+
+#ifdef _WIN32
+    StaticString scriptFlags        = commonScriptFlags;
+    StaticString scriptLibs         = "-lShlwapi";
+#else
+    // -fno-gnu-unique: inline variables would otherwise be unique symbols, which keep a module loaded after dlclose() and defeat reloading it.
+    StaticString scriptFlags        = commonScriptFlags * "-fPIC -pthread -fno-gnu-unique";
+    StaticString scriptLibs         = "";
+#endif
@@ -9,6 +9,7 @@
 // ======================================================================================================= //
 
 #include "TraumaBuildSystem.hpp"
+#include "Config.hpp"
 
 TRAUMA_BUILD_SYSTEM(v1::Experimental)
 
@@ -26,11 +27,19 @@ int main()
 
     StaticString cppFlags               = "-s -std=c++20 -O3 -DNDEBUG -fno-rtti -fno-exceptions -ISources";
 
+    #ifdef _WIN32
+        StaticString runnerName         = "build.exe";
+        StaticString runnerLibs         = "-lShlwapi";
+    #else
+        StaticString runnerName         = "build";
+        StaticString runnerLibs         = "-ldl -pthread";
+    #endif
+
     if (Exists(buildDir))
         DeleteDirectory(buildDir);
     CreateDirectory(buildDir);
 
-    Call("g++" * cppFlags * "-o" + buildDir / "build.exe Sources/TraumaBuildSystem.cpp -lShlwapi");
+    Call("g++" * cppFlags * "-o" * buildDir / runnerName * "Sources/TraumaBuildSystem.cpp" * runnerLibs);
 
     auto [tbsFileBuffer, tbsFileBufferSize] = ReadFile("Sources/TraumaBuildSystem.hpp");
     char* p = tbsFileBuffer;
@@ -79,4 +88,8 @@ int main()
     // NOTE: Shall we let the OS do the cleaning? We probably should.
     fclose(outFile);
     free(tbsFileBuffer);
+
+    // GCC picks TraumaBuildSystem.gch over TraumaBuildSystem when both sit in the same directory and the flags match.
+    // -w only silences "#pragma once in main file", warnings don't take part in the PCH validity check.
+    Call(compiler * scriptFlags * "-w -o" * buildDir / "TraumaBuildSystem.gch" * "-x c++-header" * buildDir / "TraumaBuildSystem");
 }
@@ -0,0 +1,231 @@
+// ======================================================================================================= //
+//      This file is part of Trauma Build System (https://github.com/FoxLeader/TraumaBuildSystem)          //
+//      Copyright: PolyTrauma Studios Srls, All Rights Reserved.                                           //
+//                                                                                                         //
+//      Author: Fabiano Raffaelli                                                                          //
+//                                                                                                         //
+// ======================================================================================================= //
+//      This software is licensed under Creative Commons (CC BY NC 4.0): See LICENSE.md for details.       //
+// ======================================================================================================= //
+
+#pragma once
+
+#include <cstring>
+
+#if defined(__AVX2__)
+    #include <immintrin.h>
+#elif defined(__SSE2__)
+    #include <emmintrin.h>
+#endif
+
+using size_t = decltype(sizeof(0));     static_assert(sizeof(size_t) == 8);
+using uint64 = unsigned long long;      static_assert(sizeof(uint64) == 8);
+
+
+
+namespace TraumaBuildSystem::Helpers
+{
+    /*  64 bit non cryptographic hash, meant to detect changes in file contents and command lines.
+        It follows the structure of XXH3, without being bit compatible with it: short inputs are mixed directly, longer ones
+        feed 8 accumulators 64 bytes at a time. That loop is made of 32x32->64 bit multiplies and additions only, so it maps
+        to SSE2 (or AVX2, when enabled at compile time) and hashes at memory speed.
+    */
+    uint64                          Hash(const char* const data, size_t size, uint64 seed = 0);
+
+    namespace HashImplementation
+    {
+        inline constexpr uint64     Prime32_1                       = 0x9E3779B1ull;
+        inline constexpr uint64     Prime32_2                       = 0x85EBCA77ull;
+        inline constexpr uint64     Prime32_3                       = 0xC2B2AE3Dull;
+        inline constexpr uint64     Prime64_1                       = 0x9E3779B185EBCA87ull;
+        inline constexpr uint64     Prime64_2                       = 0xC2B2AE3D27D4EB4Full;
+        inline constexpr uint64     Prime64_3                       = 0x165667B19E3779F9ull;
+        inline constexpr uint64     Prime64_4                       = 0x85EBCA77C2B2AE63ull;
+        inline constexpr uint64     Prime64_5                       = 0x27D4EB2F165667C5ull;
+
+        inline constexpr size_t     StripeSize                      = 64;
+        inline constexpr size_t     StripesPerBlock                 = 16;
+        inline constexpr size_t     BlockSize                       = StripeSize * StripesPerBlock;
+
+        // Each stripe of a block uses the secret shifted by one word, the scramble step uses the last 8 words.
+        struct Secret
+        {
+            alignas(32) uint64      words[StripesPerBlock + 8];
+        };
+
+        consteval Secret MakeSecret()
+        {
+            // SplitMix64.
+            Secret secret = {};
+            uint64 state = Prime64_1;
+            for (uint64& word : secret.words)
+            {
+                state += 0x9E3779B97F4A7C15ull;
+                uint64 z = state;
+                z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+                z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+                word = z ^ (z >> 31);
+            }
+            return secret;
+        }
+
+        inline constexpr Secret     DefaultSecret                   = MakeSecret();
+
+        inline uint64 Read32(const char* const p)                   { unsigned int value; memcpy(&value, p, sizeof(value)); return value; }
+        inline uint64 Read64(const char* const p)                   { uint64 value; memcpy(&value, p, sizeof(value)); return value; }
+        inline uint64 RotateLeft(uint64 value, int bits)            { return (value << bits) | (value >> (64 - bits)); }
+
+        inline uint64 Multiply128Fold64(uint64 a, uint64 b)
+        {
+            __extension__ using uint128 = unsigned __int128;
+            uint128 product = static_cast<uint128>(a) * b;
+            return static_cast<uint64>(product) ^ static_cast<uint64>(product >> 64);
+        }
+
+        inline uint64 Avalanche(uint64 hash)
+        {
+            hash ^= hash >> 37;
+            hash *= 0x165667919E3779F9ull;
+            return hash ^ (hash >> 32);
+        }
+
+        inline uint64 Mix16(const char* const p, const uint64* secret, uint64 seed)
+        {
+            return Multiply128Fold64(Read64(p) ^ (secret[0] + seed), Read64(p + 8) ^ (secret[1] - seed));
+        }
+
+        inline void Accumulate(uint64* accumulators, const char* const stripe, const uint64* secret)
+        {
+            #if defined(__AVX2__)
+                for (size_t i = 0; i < 2; i++)
+                {
+                    __m256i value = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(stripe) + i);
+                    __m256i key = _mm256_xor_si256(value, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(secret) + i));
+                    __m256i product = _mm256_mul_epu32(key, _mm256_shuffle_epi32(key, 0x31));
+                    __m256i swapped = _mm256_shuffle_epi32(value, 0x4E);
+                    __m256i* accumulator = reinterpret_cast<__m256i*>(accumulators) + i;
+                    _mm256_store_si256(accumulator, _mm256_add_epi64(_mm256_add_epi64(_mm256_load_si256(accumulator), swapped), product));
+                }
+            #elif defined(__SSE2__)
+                for (size_t i = 0; i < 4; i++)
+                {
+                    __m128i value = _mm_loadu_si128(reinterpret_cast<const __m128i*>(stripe) + i);
+                    __m128i key = _mm_xor_si128(value, _mm_loadu_si128(reinterpret_cast<const __m128i*>(secret) + i));
+                    __m128i product = _mm_mul_epu32(key, _mm_shuffle_epi32(key, 0x31));
+                    __m128i swapped = _mm_shuffle_epi32(value, 0x4E);
+                    __m128i* accumulator = reinterpret_cast<__m128i*>(accumulators) + i;
+                    _mm_store_si128(accumulator, _mm_add_epi64(_mm_add_epi64(_mm_load_si128(accumulator), swapped), product));
+                }
+            #else
+                for (size_t i = 0; i < 8; i++)
+                {
+                    uint64 value = Read64(stripe + i * 8);
+                    uint64 key = value ^ secret[i];
+                    accumulators[i ^ 1] += value;
+                    accumulators[i] += (key & 0xFFFFFFFF) * (key >> 32);
+                }
+            #endif
+        }
+
+        inline void Scramble(uint64* accumulators, const uint64* secret)
+        {
+            for (size_t i = 0; i < 8; i++)
+            {
+                uint64 accumulator = accumulators[i];
+                accumulator ^= accumulator >> 47;
+                accumulator ^= secret[i];
+                accumulators[i] = accumulator * Prime32_1;
+            }
+        }
+
+        inline uint64 HashLong(const char* const data, size_t size, uint64 seed)
+        {
+            const uint64* secret = DefaultSecret.words;
+            alignas(32) uint64 accumulators[8] = { Prime32_3, Prime64_1, Prime64_2, Prime64_3, Prime64_4, Prime32_2, Prime64_5, Prime32_1 };
+
+            size_t blockCount = (size - 1) / BlockSize;
+            for (size_t block = 0; block < blockCount; block++)
+            {
+                for (size_t stripe = 0; stripe < StripesPerBlock; stripe++)
+                    Accumulate(accumulators, data + block * BlockSize + stripe * StripeSize, secret + stripe);
+                Scramble(accumulators, secret + StripesPerBlock);
+            }
+
+            // The last stripe always ends at the end of the input, overlapping the previous one if needed.
+            size_t stripeCount = (size - 1 - blockCount * BlockSize) / StripeSize;
+            for (size_t stripe = 0; stripe < stripeCount; stripe++)
+                Accumulate(accumulators, data + blockCount * BlockSize + stripe * StripeSize, secret + stripe);
+            Accumulate(accumulators, data + size - StripeSize, secret + StripesPerBlock - 1);
+
+            uint64 hash = size * Prime64_1 + seed;
+            for (size_t i = 0; i < 4; i++)
+                hash += Multiply128Fold64(accumulators[i * 2] ^ secret[i * 2 + 1], accumulators[i * 2 + 1] ^ secret[i * 2 + 2]);
+            return Avalanche(hash);
+        }
+
+        inline uint64 HashShort(const char* const data, size_t size, uint64 seed)
+        {
+            const uint64* secret = DefaultSecret.words;
+
+            if (size == 0)
+                return Avalanche(seed ^ secret[7] ^ secret[8]);
+
+            if (size <= 3)
+            {
+                uint64 combined = (static_cast<uint64>(static_cast<unsigned char>(data[0])) << 16) | (static_cast<uint64>(static_cast<unsigned char>(data[size >> 1])) << 24) |
+                                  static_cast<uint64>(static_cast<unsigned char>(data[size - 1])) | (size << 8);
+                uint64 hash = combined ^ ((secret[0] & 0xFFFFFFFF) + seed);
+                hash ^= hash >> 33;
+                hash *= Prime64_2;
+                hash ^= hash >> 29;
+                hash *= Prime64_3;
+                return hash ^ (hash >> 32);
+            }
+
+            if (size <= 8)
+            {
+                uint64 hash = (Read32(data) + (Read32(data + size - 4) << 32)) ^ ((secret[1] ^ secret[2]) - seed);
+                hash ^= RotateLeft(hash, 49) ^ RotateLeft(hash, 24);
+                hash *= 0x9FB21C651E98DF25ull;
+                hash ^= (hash >> 35) + size;
+                hash *= 0x9FB21C651E98DF25ull;
+                return hash ^ (hash >> 28);
+            }
+
+            if (size <= 16)
+            {
+                uint64 low = Read64(data) ^ ((secret[3] ^ secret[4]) + seed);
+                uint64 high = Read64(data + size - 8) ^ ((secret[5] ^ secret[6]) - seed);
+                return Avalanche(size + __builtin_bswap64(low) + high + Multiply128Fold64(low, high));
+            }
+
+            // 17 to 128 bytes: pairs of 16 bytes, taken from both ends towards the middle.
+            uint64 hash = size * Prime64_1 + seed;
+            if (size > 32)
+            {
+                if (size > 64)
+                {
+                    if (size > 96)
+                    {
+                        hash += Mix16(data + 48, secret + 12, seed);
+                        hash += Mix16(data + size - 64, secret + 14, seed);
+                    }
+                    hash += Mix16(data + 32, secret + 8, seed);
+                    hash += Mix16(data + size - 48, secret + 10, seed);
+                }
+                hash += Mix16(data + 16, secret + 4, seed);
+                hash += Mix16(data + size - 32, secret + 6, seed);
+            }
+            hash += Mix16(data, secret, seed);
+            hash += Mix16(data + size - 16, secret + 2, seed);
+            return Avalanche(hash);
+        }
+    }
+
+
+
+    inline uint64 Hash(const char* const data, size_t size, uint64 seed)
+    {
+        return size <= 128 ? HashImplementation::HashShort(data, size, seed) : HashImplementation::HashLong(data, size, seed);
+    }
+}
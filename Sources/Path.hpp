@@ -0,0 +1,201 @@
+// ======================================================================================================= //
+//      This file is part of Trauma Build System (https://github.com/FoxLeader/TraumaBuildSystem)          //
+//      Copyright: PolyTrauma Studios Srls, All Rights Reserved.                                           //
+//                                                                                                         //
+//      Author: Fabiano Raffaelli                                                                          //
+//                                                                                                         //
+// ======================================================================================================= //
+//      This software is licensed under Creative Commons (CC BY NC 4.0): See LICENSE.md for details.       //
+// ======================================================================================================= //
+
+#pragma once
+
+using size_t = decltype(sizeof(0));     static_assert(sizeof(size_t) == 8);
+using uint16 = unsigned short;          static_assert(sizeof(uint16) == 2);
+
+
+
+namespace TraumaBuildSystem
+{
+    template <size_t> class String;
+
+    /*  A path to a file or a directory, stored inline: building, copying and taking apart a Path never allocates.
+        Separators are normalized once, when components are added: '/' is the only separator ('\' too is accepted on Windows),
+        repeated and trailing separators are dropped, and so are '.' components. '..' components are kept as they are,
+        resolving them needs the file system. The length and the offset of every component are stored, so moving
+        to a parent or to a child never rescans the path.
+
+        A path that doesn't fit MaxLength or MaxComponents is truncated, and is_valid() returns false from then on.
+    */
+    class Path
+    {
+        // ============================================================ Constructors / Destructors / Operators
+
+        public:
+
+        static constexpr size_t         MaxLength                       = 4095;
+        static constexpr size_t         MaxComponents                   = 256;
+
+        // Conversions are explicit, a Path is too large to be built by accident.
+        Path()                                                          { mPath[0] = '\0'; }
+        explicit Path(const char* const path)                           { mPath[0] = '\0'; append(path); }
+        template <size_t Size>
+        explicit Path(const String<Size>& path)                         : Path(path.c_str()) {}
+        Path(const Path& other)                                         { *this = other; }
+
+        // Only the used part of the buffers is copied.
+        Path&                           operator=(const Path& other)
+        {
+            if (this == &other)
+                return *this;
+
+            for (size_t i = 0; i <= other.mLength; i++)
+                mPath[i] = other.mPath[i];
+            for (size_t i = 0; i < other.mComponentCount; i++)
+                mComponents[i] = other.mComponents[i];
+            mLength = other.mLength;
+            mComponentCount = other.mComponentCount;
+            mValid = other.mValid;
+            return *this;
+        }
+
+        Path&                           operator=(const char* const path) { mLength = 0; mComponentCount = 0; mValid = true; append(path); return *this; }
+        Path&                           operator/=(const char* const path) { append(path); return *this; }
+        Path                            operator/(const char* const path) const { Path child = *this; child.append(path); return child; }
+
+        operator                        const char*() const             { return mPath; }
+
+        // ============================================================ Functions
+
+        public:
+
+        void                            append(const char* const path); // Appends the components of path. An absolute path replaces the current one.
+        bool                            pop();                          // Removes the last component. Returns false if there's none left.
+        Path                            parent() const                  { Path parent = *this; parent.pop(); return parent; }
+
+        const char*                     c_str() const                   { return mPath; }
+        char*                           data()                          { return mPath; } // Writing a separator or a terminator over the path is fine, as long as it's restored.
+        size_t                          length() const                  { return mLength; }
+        bool                            is_empty() const                { return mLength == 0; }
+        bool                            is_absolute() const;
+        bool                            is_valid() const                { return mValid; }
+
+        size_t                          component_count() const         { return mComponentCount; }
+        size_t                          component_offset(size_t index) const { return mComponents[index]; }
+        size_t                          component_length(size_t index) const { return static_cast<size_t>((index + 1 < mComponentCount ? mComponents[index + 1] - 1 : mLength) - mComponents[index]); }
+
+        const char*                     file_name() const               { return mComponentCount > 0 ? mPath + mComponents[mComponentCount - 1] : mPath + mLength; } // The last component, "" if there's none.
+        const char*                     extension() const;              // What follows the last '.' of the file name, "" if there's none. A leading '.' doesn't start an extension.
+
+        // ============================================================ Data
+
+        private:
+
+        static constexpr bool           IsSeparator(char c)
+        {
+            #ifdef _WIN32
+                return c == '/' || c == '\\';
+            #else
+                return c == '/';
+            #endif
+        }
+
+        char                            mPath[MaxLength + 1];
+        uint16                          mComponents[MaxComponents];
+        uint16                          mLength                         = 0;
+        uint16                          mComponentCount                 = 0;
+        bool                            mValid                          = true;
+    };
+
+    inline size_t Length(const Path& path)                              { return path.length(); }
+
+
+
+    inline void Path::append(const char* const path)
+    {
+        const char* p = path;
+        #ifdef _WIN32
+            bool absolute = IsSeparator(p[0]) || (p[0] != '\0' && p[1] == ':');
+        #else
+            bool absolute = IsSeparator(p[0]);
+        #endif
+        if (absolute)
+        {
+            mLength = 0;
+            mComponentCount = 0;
+            mValid = true;
+            if (IsSeparator(*p))
+                mPath[mLength++] = '/';
+        }
+
+        while (*p != '\0')
+        {
+            if (IsSeparator(*p))
+            {
+                p++;
+                continue;
+            }
+
+            const char* end = p;
+            while (*end != '\0' && !IsSeparator(*end))
+                end++;
+            size_t componentLength = static_cast<size_t>(end - p);
+
+            if (!(componentLength == 1 && p[0] == '.'))
+            {
+                bool separator = mLength > 0 && mPath[mLength - 1] != '/';
+                if (mComponentCount == MaxComponents || mLength + (separator ? 1u : 0u) + componentLength > MaxLength)
+                {
+                    mValid = false;
+                    break;
+                }
+
+                if (separator)
+                    mPath[mLength++] = '/';
+                mComponents[mComponentCount++] = mLength;
+                for (size_t i = 0; i < componentLength; i++)
+                    mPath[mLength++] = p[i];
+            }
+            p = end;
+        }
+
+        mPath[mLength] = '\0';
+    }
+
+
+
+    inline bool Path::pop()
+    {
+        if (mComponentCount == 0)
+            return false;
+
+        // The root separator stays.
+        mLength = mComponents[--mComponentCount];
+        if (mLength > 1 && mPath[mLength - 1] == '/')
+            mLength--;
+        mPath[mLength] = '\0';
+        return true;
+    }
+
+
+
+    inline bool Path::is_absolute() const
+    {
+        #ifdef _WIN32
+            return mPath[0] == '/' || (mLength >= 2 && mPath[1] == ':');
+        #else
+            return mPath[0] == '/';
+        #endif
+    }
+
+
+
+    inline const char* Path::extension() const
+    {
+        const char* fileName = file_name();
+        for (const char* p = mPath + mLength; p > fileName + 1; p--)
+            if (p[-1] == '.')
+                return p;
+        return mPath + mLength;
+    }
+}
@@ -0,0 +1,216 @@
+// ======================================================================================================= //
+//      This file is part of Trauma Build System (https://github.com/FoxLeader/TraumaBuildSystem)          //
+//      Copyright: PolyTrauma Studios Srls, All Rights Reserved.                                           //
+//                                                                                                         //
+//      Author: Fabiano Raffaelli                                                                          //
+//                                                                                                         //
+// ======================================================================================================= //
+//      This software is licensed under Creative Commons (CC BY NC 4.0): See LICENSE.md for details.       //
+// ======================================================================================================= //
+
+#pragma once
+
+#include <cstdlib>
+#include <cstring>
+
+using size_t = decltype(sizeof(0));     static_assert(sizeof(size_t) == 8);
+
+
+
+namespace TraumaBuildSystem
+{
+    template <size_t> class String;
+
+    constexpr void Replace(char* const string, size_t length, char from, char to);
+
+    /*  A string sized at runtime, for values that only exist while a script runs: working directories, absolute paths, the output of a tool.
+        Up to InlineCapacity characters are stored in the object itself, longer strings move to the heap, whose buffer grows geometrically
+        so that appending stays linear. Moving a SmallString hands its heap buffer over, and operators applied to a temporary reuse it,
+        so a chain like cwd / "a" / "b" allocates at most once.
+
+        A String remains the choice for values known at compile time, StaticString included: a SmallString can't be constexpr.
+    */
+    class SmallString
+    {
+        // ============================================================ Constructors / Destructors / Operators
+
+        public:
+
+        static constexpr size_t         InlineCapacity                  = 63;                           // Characters stored without allocating, the terminator excluded.
+
+        SmallString()                                                   { mInline[0] = '\0'; }
+        explicit SmallString(const char* const string)                  : SmallString() { append(string); }
+        SmallString(const char* const string, size_t length)            : SmallString() { append(string, length); }
+        template <size_t Size>
+        explicit SmallString(const String<Size>& string)                : SmallString() { append(string.c_str(), string.length()); }
+        SmallString(const SmallString& other)                           : SmallString() { append(other.mData, other.mLength); }
+        SmallString(SmallString&& other)                                : SmallString() { *this = static_cast<SmallString&&>(other); }
+        ~SmallString()                                                  { if (mData != mInline) free(mData); }
+
+        SmallString&                    operator=(const SmallString& other) { if (this != &other) { clear(); append(other.mData, other.mLength); } return *this; }
+        SmallString&                    operator=(SmallString&& other);
+        SmallString&                    operator=(const char* const string) { size_t length = strlen(string); mLength = 0; append(string, length); return *this; }
+        template <size_t Size>
+        SmallString&                    operator=(const String<Size>& string) { clear(); append(string.c_str(), string.length()); return *this; }
+
+        SmallString&                    operator+=(const char* const string) { append(string); return *this; }
+        SmallString&                    operator+=(const SmallString& string) { append(string.mData, string.mLength); return *this; }
+        template <size_t Size>
+        SmallString&                    operator+=(const String<Size>& string) { append(string.c_str(), string.length()); return *this; }
+
+        char&                           operator[](size_t index)        { return mData[index]; }
+        const char&                     operator[](size_t index) const  { return mData[index]; }
+
+        operator                        const char*() const             { return mData; }
+
+        // ============================================================ Functions
+
+        public:
+
+        void                            append(const char* const string, size_t length);
+        void                            append(const char* const string) { append(string, strlen(string)); }
+        void                            push(char c)                    { reserve(mLength + 1); mData[mLength++] = c; mData[mLength] = '\0'; }
+
+        void                            reserve(size_t capacity);       // Makes room for capacity characters, the terminator excluded.
+        void                            resize(size_t length)           { reserve(length); mLength = length; mData[mLength] = '\0'; } // Characters past the old length are left as they are, the buffer can be filled through data() first.
+        void                            clear()                         { mLength = 0; mData[0] = '\0'; }
+        void                            replace(char from, char to);
+
+        const char*                     c_str() const                   { return mData; }
+        char*                           data()                          { return mData; } // Writing a terminator doesn't change length(), resize() does.
+        size_t                          length() const                  { return mLength; }
+        size_t                          capacity() const                { return mCapacity; }
+        bool                            is_empty() const                { return mLength == 0; }
+
+        // ============================================================ Data
+
+        private:
+
+        char*                           mData                           = mInline;
+        size_t                          mLength                         = 0;
+        size_t                          mCapacity                       = InlineCapacity;
+        char                            mInline[InlineCapacity + 1];
+    };
+
+    inline size_t Length(const SmallString& string)                     { return string.length(); }
+
+    // Concatenations. Like with String, + joins, * joins with a blank and / joins with a slash. A temporary on the left is extended in place.
+    namespace SmallStringOperators
+    {
+        inline SmallString Join(SmallString&& a, const char* const separator, const char* const b, size_t bLength)
+        {
+            size_t separatorLength = strlen(separator);
+            a.reserve(a.length() + separatorLength + bLength);
+            a.append(separator, separatorLength);
+            a.append(b, bLength);
+            return static_cast<SmallString&&>(a);
+        }
+
+        inline SmallString Join(const char* const a, size_t aLength, const char* const separator, const char* const b, size_t bLength)
+        {
+            SmallString string;
+            string.reserve(aLength + strlen(separator) + bLength);
+            string.append(a, aLength);
+            return Join(static_cast<SmallString&&>(string), separator, b, bLength);
+        }
+    }
+
+    #define TBS_SMALL_STRING_OPERATOR(op, separator) \
+        inline SmallString operator op(const SmallString& a, const SmallString& b)              { return SmallStringOperators::Join(a.c_str(), a.length(), separator, b.c_str(), b.length()); } \
+        inline SmallString operator op(SmallString&& a, const SmallString& b)                   { return SmallStringOperators::Join(static_cast<SmallString&&>(a), separator, b.c_str(), b.length()); } \
+        inline SmallString operator op(const SmallString& a, const char* const b)               { return SmallStringOperators::Join(a.c_str(), a.length(), separator, b, strlen(b)); } \
+        inline SmallString operator op(SmallString&& a, const char* const b)                    { return SmallStringOperators::Join(static_cast<SmallString&&>(a), separator, b, strlen(b)); } \
+        inline SmallString operator op(const char* const a, const SmallString& b)               { return SmallStringOperators::Join(a, strlen(a), separator, b.c_str(), b.length()); } \
+        template <size_t Size> \
+        inline SmallString operator op(const SmallString& a, const String<Size>& b)             { return SmallStringOperators::Join(a.c_str(), a.length(), separator, b.c_str(), b.length()); } \
+        template <size_t Size> \
+        inline SmallString operator op(SmallString&& a, const String<Size>& b)                  { return SmallStringOperators::Join(static_cast<SmallString&&>(a), separator, b.c_str(), b.length()); } \
+        template <size_t Size> \
+        inline SmallString operator op(const String<Size>& a, const SmallString& b)             { return SmallStringOperators::Join(a.c_str(), a.length(), separator, b.c_str(), b.length()); }
+
+    TBS_SMALL_STRING_OPERATOR(+, "")
+    TBS_SMALL_STRING_OPERATOR(*, " ")
+    TBS_SMALL_STRING_OPERATOR(/, "/")
+
+    #undef TBS_SMALL_STRING_OPERATOR
+
+
+
+    inline SmallString& SmallString::operator=(SmallString&& other)
+    {
+        if (this == &other)
+            return *this;
+
+        if (other.mData != other.mInline)
+        {
+            if (mData != mInline)
+                free(mData);
+            mData = other.mData;
+            mCapacity = other.mCapacity;
+            mLength = other.mLength;
+            other.mData = other.mInline;
+            other.mCapacity = InlineCapacity;
+        }
+        else
+        {
+            clear();
+            append(other.mData, other.mLength);
+        }
+
+        other.clear();
+        return *this;
+    }
+
+
+
+    inline void SmallString::append(const char* const string, size_t length)
+    {
+        // string may point into this very buffer, which reserve() can move.
+        const char* source = string;
+        if (mLength + length > mCapacity)
+        {
+            bool inside = string >= mData && string <= mData + mLength;
+            size_t offset = inside ? static_cast<size_t>(string - mData) : 0;
+            reserve(mLength + length);
+            if (inside)
+                source = mData + offset;
+        }
+
+        memmove(mData + mLength, source, length);
+        mLength += length;
+        mData[mLength] = '\0';
+    }
+
+
+
+    inline void SmallString::reserve(size_t capacity)
+    {
+        if (capacity <= mCapacity)
+            return;
+
+        size_t newCapacity = mCapacity * 2 + 1;
+        while (newCapacity < capacity)
+            newCapacity = newCapacity * 2 + 1;
+
+        char* newData;
+        if (mData == mInline)
+        {
+            newData = static_cast<char*>(malloc(newCapacity + 1));
+            memcpy(newData, mInline, mLength + 1);
+        }
+        else
+            newData = static_cast<char*>(realloc(mData, newCapacity + 1));
+
+        mData = newData;
+        mCapacity = newCapacity;
+    }
+
+
+
+    inline void SmallString::replace(char from, char to)
+    {
+        Replace(mData, mLength, from, to);
+        if (to == '\0')
+            mLength = strlen(mData);
+    }
+}
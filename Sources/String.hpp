@@ -12,7 +12,13 @@
 
 #define StaticString constexpr TraumaBuildSystem::String
 
-using size_t = unsigned long long; static_assert(sizeof(size_t) == 8);
+#if defined(__AVX2__)
+    #include <immintrin.h>
+#elif defined(__SSE2__)
+    #include <emmintrin.h>
+#endif
+
+using size_t = decltype(sizeof(0)); static_assert(sizeof(size_t) == 8);
 
 
 
@@ -20,9 +26,32 @@ namespace TraumaBuildSystem
 {
     inline constexpr size_t InvalidStringIndex = static_cast<size_t>(-1);
 
+    template <size_t> class String;
+
     constexpr size_t FindFirstOf(const char* const string, const char* const set);
     constexpr size_t FindLastOf(const char* const string, const char* const set, size_t stringLength = InvalidStringIndex);
+    template <size_t Size>
+    constexpr size_t FindLastOf(const String<Size>& string, const char* const set, size_t stringLength = InvalidStringIndex);
+    constexpr bool ContainsAnyOf(const char* const string, const char* const set);
+    template <size_t Size>
+    constexpr bool ContainsAnyOf(const String<Size>& string, const char* const set);
+    constexpr void Replace(char* const string, size_t length, char from, char to);  // Replaces every occurrence of from in the first length characters of string.
     constexpr size_t Length(const char* const string);
+    template <size_t Size>
+    constexpr size_t Length(const String<Size>& string);
+
+    /*  Runtime versions of the functions above. Constant evaluation can't use intrinsics, so the constexpr functions only call these
+        when they run at runtime. They compare 16 (SSE2) or 32 (AVX2, when enabled at compile time) characters at once, and fall back
+        to plain loops on other architectures. Sets are short in practice, each of their characters costs one comparison per block.
+    */
+    namespace StringKernels
+    {
+        size_t                      Length(const char* const string);
+        size_t                      Length(const char* const string, size_t maxLength);               // Returns maxLength if there is no terminator in the first maxLength characters of string, which are the only ones read.
+        size_t                      FindFirstOf(const char* const string, size_t length, const char* const set);   // Returns InvalidStringIndex if no character of set is in the first length characters of string.
+        size_t                      FindLastOf(const char* const string, size_t length, const char* const set);    // Same as above, searching from the end.
+        void                        Replace(char* const string, size_t length, char from, char to);
+    }
 
     template <size_t MaxSize>
     class String
@@ -46,44 +75,84 @@ namespace TraumaBuildSystem
         constexpr String&               operator=(const String<StringSize>& string) { copy(string); return *this; }
         constexpr String&               operator=(const char* const string) { copy(string); return *this; }
 
-        constexpr char&                 operator[](size_t index) { return mString[index]; }
+        // Writing through a non const accessor may change the length, it's measured again when needed.
+        constexpr char&                 operator[](size_t index) { mLength = UnknownLength; return mString[index]; }
         constexpr const char&           operator[](size_t index) const { return mString[index]; }
 
         constexpr operator              const char*() const { return mString; }
-        constexpr operator              char*() { return mString; }
+        constexpr operator              char*() { mLength = UnknownLength; return mString; }
 
         // ============================================================ Functions
 
         public:
 
         template <size_t StringSize>
-        constexpr void                  append(const String<StringSize>& string, size_t stringOffset = 0, size_t stringLength = InvalidStringIndex) { copy(string.c_str(), Length(mString), stringLength, stringOffset); }
-        constexpr void                  append(const char* string, size_t stringOffset = 0, size_t stringLength = InvalidStringIndex) { copy(string, Length(mString), stringLength, stringOffset); }
+        constexpr void                  append(const String<StringSize>& string, size_t stringOffset = 0, size_t stringLength = InvalidStringIndex) { write(string.c_str() + stringOffset, string.length(), length(), stringLength, stringOffset); }
+        constexpr void                  append(const char* string, size_t stringOffset = 0, size_t stringLength = InvalidStringIndex) { write(string + stringOffset, UnknownLength, length(), stringLength, stringOffset); }
 
-        constexpr char*                 data() { return mString; }
+        constexpr char*                 data() { mLength = UnknownLength; return mString; }
         constexpr const char*           c_str() const { return mString; }
 
+        constexpr size_t                length() const { return mLength != UnknownLength ? mLength : TraumaBuildSystem::Length(mString); }
         constexpr bool                  is_empty() const { return mString[0] == '\0'; }
 
         constexpr void                  copy(const char* const string, size_t offset = 0, size_t stringLength = InvalidStringIndex, size_t stringOffset = 0)
         {
-            const char* p = string + stringOffset;
-            if (stringLength == InvalidStringIndex)
-                stringLength = Length(string);
-            size_t c = 0;
-            while (p[c] != '\0' && c + offset < MaxSize - 1 && c + stringOffset < stringLength && c < stringLength)
-            {
-                mString[c + offset] = p[c];
-                c++;
-            }
-            mString[c + offset] = '\0';
+            write(string + stringOffset, UnknownLength, offset, stringLength, stringOffset);
+        }
+
+        template <size_t StringSize>
+        constexpr void                  copy(const String<StringSize>& string, size_t offset = 0, size_t stringLength = InvalidStringIndex, size_t stringOffset = 0)
+        {
+            write(string.c_str() + stringOffset, string.length(), offset, stringLength, stringOffset);
+        }
+
+        constexpr void                  replace(char from, char to)
+        {
+            size_t currentLength = length();
+            TraumaBuildSystem::Replace(mString, currentLength, from, to);
+            mLength = to != '\0' ? currentLength : UnknownLength;
         }
 
         // ============================================================ Data
 
         private:
 
+        static constexpr size_t         UnknownLength                   = InvalidStringIndex;
+
+        // Copies source at offset, stopping at its terminator, at stringLength - stringOffset characters or when the String is full.
+        // sourceLength is the length of the whole source string if it's known, stringOffset included.
+        constexpr void                  write(const char* const source, size_t sourceLength, size_t offset, size_t stringLength, size_t stringOffset)
+        {
+            size_t count = stringOffset < stringLength ? stringLength - stringOffset : 0;
+            if (count > MaxSize - 1 - offset)
+                count = MaxSize - 1 - offset;
+
+            if (__builtin_is_constant_evaluated())
+            {
+                size_t c = 0;
+                while (c < count && source[c] != '\0')
+                {
+                    mString[c + offset] = source[c];
+                    c++;
+                }
+                count = c;
+            }
+            else
+            {
+                // With a limit, the terminator is only looked for within count characters: source may be a slice of a buffer that has none.
+                size_t available = sourceLength != UnknownLength ? sourceLength - stringOffset : stringLength != InvalidStringIndex ? StringKernels::Length(source, count) : StringKernels::Length(source);
+                if (available < count)
+                    count = available;
+                __builtin_memmove(mString + offset, source, count);
+            }
+
+            mString[offset + count] = '\0';
+            mLength = offset + count;
+        }
+
         char                            mString[MaxSize]                = {};
+        size_t                          mLength                         = 0;
     };
 
     template <size_t aSize, size_t bSize>
@@ -175,73 +244,74 @@ namespace TraumaBuildSystem
 
 
 
-    // inline constexpr size_t FindFirstOf(const char* const string, const char* const set)
-    // {
-    //     size_t stringLength = Length(string);
-    //     size_t index = InvalidStringIndex;
-    //     const char* p = string;
-    //
-    //     for (size_t i = 0; i < MaxSize && mString[i] != '\0' && index == InvalidStringIndex; i++)
-    //         for (size_t k = 0; k < stringLength; k++)
-    //             if (mString[i] == p[k])
-    //             {
-    //                 index = i;
-    //                 break;
-    //             }
-    //
-    //     return index;
-    // }
+    inline constexpr size_t FindFirstOf(const char* const string, const char* const set)
+    {
+        if (!__builtin_is_constant_evaluated())
+            return StringKernels::FindFirstOf(string, StringKernels::Length(string), set);
+
+        for (size_t i = 0; string[i] != '\0'; i++)
+            for (const char* pSet = set; *pSet != '\0'; pSet++)
+                if (string[i] == *pSet)
+                    return i;
+
+        return InvalidStringIndex;
+    }
 
 
 
+    // The character at stringLength is searched too, when it's within the string.
     inline constexpr size_t FindLastOf(const char* const string, const char* const set, size_t stringLength)
     {
         size_t actualStringLength = Length(string);
-        const char* pStr = actualStringLength < stringLength ?
-            string + actualStringLength :
-            string + stringLength;
+        size_t end = stringLength < actualStringLength ? stringLength + 1 : actualStringLength;
 
-        const char* pSet = set;
-        size_t index = InvalidStringIndex;
+        if (!__builtin_is_constant_evaluated())
+            return StringKernels::FindLastOf(string, end, set);
 
-        while (string <= pStr && index == InvalidStringIndex)
-        {
-            while (*pSet != '\0')
-            {
-                if (*pStr == *pSet)
-                {
-                    index = static_cast<size_t>(pStr - string);
-                    break;
-                }
-                pSet++;
-            }
-            pSet = set;
-            pStr--;
-        }
+        for (size_t i = end; i > 0; i--)
+            for (const char* pSet = set; *pSet != '\0'; pSet++)
+                if (string[i - 1] == *pSet)
+                    return i - 1;
 
-        return index;
+        return InvalidStringIndex;
+    }
+
+    template <size_t Size>
+    inline constexpr size_t FindLastOf(const String<Size>& string, const char* const set, size_t stringLength)
+    {
+        size_t actualStringLength = string.length();
+        size_t end = stringLength < actualStringLength ? stringLength + 1 : actualStringLength;
+
+        if (!__builtin_is_constant_evaluated())
+            return StringKernels::FindLastOf(string.c_str(), end, set);
+        return FindLastOf(string.c_str(), set, stringLength);
     }
 
 
 
     inline constexpr bool ContainsAnyOf(const char* const string, const char* const set)
     {
-        const char* pStr = string;
-        const char* pSet = set;
+        return FindFirstOf(string, set) != InvalidStringIndex;
+    }
 
-        while (*pStr != '\0')
-        {
-            while (*pSet != '\0')
-            {
-                if (*pStr == *pSet)
-                    return true;
-                pSet++;
-            }
-            pSet = set;
-            pStr++;
-        }
+    template <size_t Size>
+    inline constexpr bool ContainsAnyOf(const String<Size>& string, const char* const set)
+    {
+        if (!__builtin_is_constant_evaluated())
+            return StringKernels::FindFirstOf(string.c_str(), string.length(), set) != InvalidStringIndex;
+        return FindFirstOf(string.c_str(), set) != InvalidStringIndex;
+    }
+
+
+
+    inline constexpr void Replace(char* const string, size_t length, char from, char to)
+    {
+        if (!__builtin_is_constant_evaluated())
+            return StringKernels::Replace(string, length, from, to);
 
-        return false;
+        for (size_t i = 0; i < length; i++)
+            if (string[i] == from)
+                string[i] = to;
     }
 
 
@@ -253,9 +323,190 @@ namespace TraumaBuildSystem
 
     inline constexpr size_t Length(const char* const string)
     {
+        if (!__builtin_is_constant_evaluated())
+            return StringKernels::Length(string);
+
         size_t c = 0;
         while (string[c] != '\0')
             c++;
         return c;
     }
+
+    template <size_t Size>
+    inline constexpr size_t Length(const String<Size>& string)
+    {
+        return string.length();
+    }
+
+
+
+    namespace StringKernels
+    {
+        #if defined(__AVX2__) || defined(__SSE2__)
+            #if defined(__AVX2__)
+                using Vector = __m256i;
+                inline Vector Load(const char* const p)             { return _mm256_load_si256(reinterpret_cast<const Vector*>(p)); }
+                inline Vector LoadUnaligned(const char* const p)    { return _mm256_loadu_si256(reinterpret_cast<const Vector*>(p)); }
+                inline void StoreUnaligned(char* const p, Vector v) { _mm256_storeu_si256(reinterpret_cast<Vector*>(p), v); }
+                inline Vector Splat(char c)                         { return _mm256_set1_epi8(c); }
+                inline Vector Zero()                                { return _mm256_setzero_si256(); }
+                inline Vector Equal(Vector a, Vector b)             { return _mm256_cmpeq_epi8(a, b); }
+                inline Vector Or(Vector a, Vector b)                { return _mm256_or_si256(a, b); }
+                inline Vector Select(Vector mask, Vector a, Vector b) { return _mm256_blendv_epi8(b, a, mask); }
+                inline unsigned int Mask(Vector v)                  { return static_cast<unsigned int>(_mm256_movemask_epi8(v)); }
+            #else
+                using Vector = __m128i;
+                inline Vector Load(const char* const p)             { return _mm_load_si128(reinterpret_cast<const Vector*>(p)); }
+                inline Vector LoadUnaligned(const char* const p)    { return _mm_loadu_si128(reinterpret_cast<const Vector*>(p)); }
+                inline void StoreUnaligned(char* const p, Vector v) { _mm_storeu_si128(reinterpret_cast<Vector*>(p), v); }
+                inline Vector Splat(char c)                         { return _mm_set1_epi8(c); }
+                inline Vector Zero()                                { return _mm_setzero_si128(); }
+                inline Vector Equal(Vector a, Vector b)             { return _mm_cmpeq_epi8(a, b); }
+                inline Vector Or(Vector a, Vector b)                { return _mm_or_si128(a, b); }
+                inline Vector Select(Vector mask, Vector a, Vector b) { return _mm_or_si128(_mm_and_si128(mask, a), _mm_andnot_si128(mask, b)); }
+                inline unsigned int Mask(Vector v)                  { return static_cast<unsigned int>(_mm_movemask_epi8(v)); }
+            #endif
+
+            inline constexpr size_t Width = sizeof(Vector);
+
+            // One bit per character of block, set if the character is in set.
+            inline unsigned int MatchSet(Vector block, const char* const set)
+            {
+                Vector matches = Zero();
+                for (const char* pSet = set; *pSet != '\0'; pSet++)
+                    matches = Or(matches, Equal(block, Splat(*pSet)));
+                return Mask(matches);
+            }
+
+            inline bool InSet(char c, const char* const set)
+            {
+                for (const char* pSet = set; *pSet != '\0'; pSet++)
+                    if (c == *pSet)
+                        return true;
+                return false;
+            }
+
+            inline size_t Length(const char* const string)
+            {
+                // Aligned loads never cross a page, so reading before the start or past the terminator is safe.
+                // The characters before the start are shifted out of the first mask.
+                size_t misalignment = reinterpret_cast<size_t>(string) & (Width - 1);
+                const char* block = string - misalignment;
+                unsigned int mask = Mask(Equal(Load(block), Zero())) >> misalignment;
+                if (mask != 0)
+                    return static_cast<size_t>(__builtin_ctz(mask));
+
+                for (;;)
+                {
+                    block += Width;
+                    mask = Mask(Equal(Load(block), Zero()));
+                    if (mask != 0)
+                        return static_cast<size_t>(block - string) + static_cast<size_t>(__builtin_ctz(mask));
+                }
+            }
+
+            inline size_t Length(const char* const string, size_t maxLength)
+            {
+                if (maxLength == 0)
+                    return 0;
+
+                // Like above, no block is loaded past the one holding the last character allowed.
+                size_t misalignment = reinterpret_cast<size_t>(string) & (Width - 1);
+                const char* block = string - misalignment;
+                unsigned int mask = Mask(Equal(Load(block), Zero())) >> misalignment;
+                size_t length = mask != 0 ? static_cast<size_t>(__builtin_ctz(mask)) : InvalidStringIndex;
+                for (size_t scanned = Width - misalignment; length == InvalidStringIndex && scanned < maxLength; scanned += Width)
+                {
+                    block += Width;
+                    mask = Mask(Equal(Load(block), Zero()));
+                    if (mask != 0)
+                        length = scanned + static_cast<size_t>(__builtin_ctz(mask));
+                }
+                return length < maxLength ? length : maxLength;
+            }
+
+            inline size_t FindFirstOf(const char* const string, size_t length, const char* const set)
+            {
+                size_t i = 0;
+                for (; i + Width <= length; i += Width)
+                    if (unsigned int mask = MatchSet(LoadUnaligned(string + i), set); mask != 0)
+                        return i + static_cast<size_t>(__builtin_ctz(mask));
+
+                for (; i < length; i++)
+                    if (InSet(string[i], set))
+                        return i;
+                return InvalidStringIndex;
+            }
+
+            inline size_t FindLastOf(const char* const string, size_t length, const char* const set)
+            {
+                size_t i = length;
+                for (; i >= Width; i -= Width)
+                    if (unsigned int mask = MatchSet(LoadUnaligned(string + i - Width), set); mask != 0)
+                        return i - Width + 31 - static_cast<size_t>(__builtin_clz(mask));
+
+                for (; i > 0; i--)
+                    if (InSet(string[i - 1], set))
+                        return i - 1;
+                return InvalidStringIndex;
+            }
+
+            inline void Replace(char* const string, size_t length, char from, char to)
+            {
+                Vector vFrom = Splat(from);
+                Vector vTo = Splat(to);
+                size_t i = 0;
+                for (; i + Width <= length; i += Width)
+                {
+                    Vector block = LoadUnaligned(string + i);
+                    StoreUnaligned(string + i, Select(Equal(block, vFrom), vTo, block));
+                }
+
+                for (; i < length; i++)
+                    if (string[i] == from)
+                        string[i] = to;
+            }
+        #else
+            inline size_t Length(const char* const string)
+            {
+                size_t c = 0;
+                while (string[c] != '\0')
+                    c++;
+                return c;
+            }
+
+            inline size_t Length(const char* const string, size_t maxLength)
+            {
+                size_t c = 0;
+                while (c < maxLength && string[c] != '\0')
+                    c++;
+                return c;
+            }
+
+            inline size_t FindFirstOf(const char* const string, size_t length, const char* const set)
+            {
+                for (size_t i = 0; i < length; i++)
+                    for (const char* pSet = set; *pSet != '\0'; pSet++)
+                        if (string[i] == *pSet)
+                            return i;
+                return InvalidStringIndex;
+            }
+
+            inline size_t FindLastOf(const char* const string, size_t length, const char* const set)
+            {
+                for (size_t i = length; i > 0; i--)
+                    for (const char* pSet = set; *pSet != '\0'; pSet++)
+                        if (string[i - 1] == *pSet)
+                            return i - 1;
+                return InvalidStringIndex;
+            }
+
+            inline void Replace(char* const string, size_t length, char from, char to)
+            {
+                for (size_t i = 0; i < length; i++)
+                    if (string[i] == from)
+                        string[i] = to;
+            }
+        #endif
+    }
 }
@@ -9,42 +9,679 @@
 // ======================================================================================================= //
 
 #include "TraumaBuildSystem.hpp"
+#include "Config.hpp"
+
+#ifdef __linux__
+    #include <signal.h>
+    #include <sys/inotify.h>
+    #include <sys/socket.h>
+    #include <sys/un.h>
+#endif
 
 TRAUMA_BUILD_SYSTEM(v1::Experimental)
 
-// Edit  Me --->
+struct BuildScript
+{
+    String<256>                     name;
+    DynamicLibrary                  module                          = nullptr;                      // Kept loaded between builds by the resident runner and in watch mode.
+    int                             exitCode                        = -1;
+    bool                            upToDate                        = false;
+    bool                            reloaded                        = false;                        // The module was loaded since the script last ran.
+    Array<SmallString>              dependencyFiles                 = {};                           // What its last run read, as recorded in its DependencyLog.
+    Array<SmallString>              inputs                          = {};
+    Array<uint64>                   watched                         = {};                           // Hashes of the watch and the name of each file in watch mode.
+    Array<int>                      watches                         = {};                           // The watches on the directories of those files.
+};
 
-StaticString buildsDir              = "../Builds";
-StaticString cacheDir               = buildsDir / ".cache";
-StaticString buildScriptsDir        = "BuildScripts";
-StaticString additionalFlags        = "-Wall -Wextra -Wpedantic -Wsign-conversion ";
+struct CompileQueue
+{
+    Array<BuildScript>&             scripts;
+    uint64                          baseKey;                        // Hash of everything but the script itself that affects its module.
+    size_t                          next                            = 0;
+    size_t                          workers                         = 0;                            // Workers started so far, each one is a slot on the build timeline.
+};
 
-// <--- Edit Me
+// Scripts and the header are only read again when their size, modification time or inode changed.
+StaticString fingerprintsFile       = cacheDir / "Fingerprints";
 
-int main(int argc, char** argv)
+// A compiled module is reused as long as the key stored next to it matches the one of its script.
+// The key covers the script source, the TraumaBuildSystem header, the compiler flags and the compiler identity.
+uint64 ComputeBaseKey()
+{
+    String<1024> compilerIdentity;
+    Call(compiler * "--version", compilerIdentity);
+
+    uint64 key = TraumaBuildSystem::Helpers::Hash(compilerIdentity, Length(compilerIdentity));
+    key = TraumaBuildSystem::Helpers::Hash(scriptFlags, Length(scriptFlags), key);
+    key = TraumaBuildSystem::Helpers::Hash(scriptLibs, Length(scriptLibs), key);
+
+    uint64 header = Fingerprint(buildScriptsDir / "TraumaBuildSystem");
+    return TraumaBuildSystem::Helpers::Hash(reinterpret_cast<const char*>(&header), sizeof(header), key);
+}
+
+// Worker thread: compiles scripts until the queue is exhausted, storing each compiler's output in a log next to the module.
+void CompileScripts(void* data)
 {
-    if (argc == 2 && IsValidPath(argv[1]))
-        CurrentWorkingDirectory(argv[1]);
+    auto& queue = *static_cast<CompileQueue*>(data);
+    TraumaBuildSystem::Helpers::gTraceSlot = __atomic_fetch_add(&queue.workers, 1, __ATOMIC_RELAXED);
+    for (size_t i = __atomic_fetch_add(&queue.next, 1, __ATOMIC_RELAXED); i < queue.scripts.size(); i = __atomic_fetch_add(&queue.next, 1, __ATOMIC_RELAXED))
+    {
+        BuildScript& script = queue.scripts[i];
+        String scriptFile = buildScriptsDir / script.name;
+        String moduleFile = cacheDir / buildScriptsDir / script.name;
+        String keyFile = moduleFile + ".key";
+
+        uint64 source = Fingerprint(scriptFile);
+        auto key = TraumaBuildSystem::Helpers::ToHexString(TraumaBuildSystem::Helpers::Hash(reinterpret_cast<const char*>(&source), sizeof(source), queue.baseKey));
+
+        auto [storedKey, storedKeySize] = ReadFile(keyFile);
+        script.upToDate = storedKey && strcmp(storedKey, key) == 0 && Exists(moduleFile);
+        free(storedKey);
+        if (script.upToDate)
+        {
+            script.exitCode = 0;
+            continue;
+        }
+
+        // The key is only written back once the module is complete, so an interrupted or failed compile is retried on the next run.
+        DeleteFile(keyFile);
+        auto cmd = compiler * scriptFlags * "-o" * moduleFile * "-x c++" * scriptFile * scriptLibs;
+        uint64 startTime = TraumaBuildSystem::Helpers::MonotonicTime();
+        script.exitCode = TraumaBuildSystem::Platform::RunProcess(cmd, moduleFile + ".log");
+        TraumaBuildSystem::Helpers::RecordTrace("Script", script.name.c_str(), cmd.c_str(), startTime, script.exitCode);
+        if (script.exitCode == 0)
+            if (FILE* f = fopen(keyFile, "wb"))
+            {
+                fwrite(key, 1, Length(key), f);
+                fclose(f);
+            }
+    }
+}
+
+// Lists the scripts in name order, on every platform, whatever order the file system lists them in.
+// Modules loaded for scripts that are still there are carried over, the ones of removed scripts are unloaded.
+void FindScripts(Array<BuildScript>& scripts)
+{
+    Array<BuildScript> found;
+    ForEachFile(buildScriptsDir / "*.build", [&] (auto&& script) { found.push({ script }); });
+    TraumaBuildSystem::Helpers::Sort(found.data(), found.size(), [] (const BuildScript& a, const BuildScript& b) { return strcmp(a.name, b.name) < 0; });
+
+    for (BuildScript& script : scripts)
+    {
+        if (!script.module)
+            continue;
+
+        BuildScript* kept = nullptr;
+        for (BuildScript& candidate : found)
+            if (strcmp(candidate.name, script.name) == 0)
+                kept = &candidate;
 
-    if (Exists(cacheDir))
-        DeleteDirectory(cacheDir);
-    CreateDirectory(cacheDir / buildScriptsDir);
+        if (kept)
+        {
+            kept->module = script.module;
+            kept->exitCode = script.exitCode;
+            kept->upToDate = script.upToDate;
+            kept->reloaded = script.reloaded;
+            kept->dependencyFiles = static_cast<Array<SmallString>&&>(script.dependencyFiles);
+            kept->inputs = static_cast<Array<SmallString>&&>(script.inputs);
+            kept->watched = static_cast<Array<uint64>&&>(script.watched);
+            kept->watches = static_cast<Array<int>&&>(script.watches);
+        }
+        else
+            TraumaBuildSystem::Platform::FreeLibrary(script.module);
+    }
+    scripts = static_cast<Array<BuildScript>&&>(found);
+}
 
+// Compiles the scripts whose module is out of date, jobs at a time, then prints each compiler's output in script order.
+void CheckScripts(Array<BuildScript>& scripts, size_t jobs)
+{
     ClearConsole();
     Println("=== Checking Scripts ===");
-    ForEachFile(buildScriptsDir / "*.build", [&] (auto&& script)
+    CompileQueue queue = { scripts, ComputeBaseKey() };
+    Array<ThreadHandle> workers;
+    for (size_t i = 0; i < jobs && i < scripts.size(); i++)
+        workers.push(TraumaBuildSystem::Platform::StartThread(CompileScripts, &queue));
+    for (ThreadHandle worker : workers)
+        TraumaBuildSystem::Platform::JoinThread(worker);
+    SaveFingerprints(fingerprintsFile);
+
+    for (const BuildScript& script : scripts)
     {
-        Println("%s...", script.c_str());
-        Call("g++ -s -std=c++20 -x c++ -shared" * additionalFlags * "-fdiagnostics-color=always -fno-rtti -fno-exceptions -o" * cacheDir / buildScriptsDir / script * buildScriptsDir / script * "-lShlwapi");
-    });
+        if (script.upToDate)
+        {
+            Println("%s... Up to date.", script.name.c_str());
+            continue;
+        }
+
+        Println("%s...", script.name.c_str());
+        auto [log, logSize] = ReadFile(cacheDir / buildScriptsDir / script.name + ".log");
+        if (log)
+        {
+            fwrite(log, 1, logSize, stdout);
+            free(log);
+        }
+    }
     Println("=== Checks Terminated ===\n");
+}
+
+// Loads the module of every script that compiled. Modules that were just recompiled are reloaded, the ones of scripts that failed are unloaded.
+void LoadScripts(Array<BuildScript>& scripts)
+{
+    for (BuildScript& script : scripts)
+    {
+        if (script.module && script.upToDate && script.exitCode == 0)
+            continue;
+
+        if (script.module)
+            TraumaBuildSystem::Platform::FreeLibrary(script.module);
+        script.module = script.exitCode == 0 ? TraumaBuildSystem::Platform::LoadLibrary(cacheDir / buildScriptsDir / script.name) : nullptr;
+        script.reloaded = script.module != nullptr;
+    }
+}
+
+void UnloadScripts(Array<BuildScript>& scripts)
+{
+    for (BuildScript& script : scripts)
+    {
+        if (script.module)
+            TraumaBuildSystem::Platform::FreeLibrary(script.module);
+        script.module = nullptr;
+    }
+}
+
+// Runs BuildSteps() of a loaded script, recording what its steps read.
+void RunScript(BuildScript& script)
+{
+    // Each module has its own copy of TBS, the script's events must go to the runner's timeline.
+    using AttachFnPtr = void(*)(void*);
+    if (auto AttachTrace = TraumaBuildSystem::Platform::GetFunction<AttachFnPtr>(script.module, "AttachTrace"))
+        AttachTrace(TraumaBuildSystem::Helpers::gTrace);
+
+    TraumaBuildSystem::Helpers::DependencyLog dependencies;
+    if (auto AttachDependencyLog = TraumaBuildSystem::Platform::GetFunction<AttachFnPtr>(script.module, "AttachDependencyLog"))
+        AttachDependencyLog(&dependencies);
+
+    Println("=== Build Process Started: %s ===", script.name.c_str());
+    uint64 startTime = TraumaBuildSystem::Helpers::MonotonicTime();
+    TraumaBuildSystem::Platform::GetFunction(script.module, "BuildSteps")();
+    TraumaBuildSystem::Helpers::RecordTrace("BuildSteps", script.name.c_str(), (cacheDir / buildScriptsDir / script.name).c_str(), startTime, 0);
+    Println("=== Build Process Terminated: %s ===\n", script.name.c_str());
+
+    if (auto AttachDependencyLog = TraumaBuildSystem::Platform::GetFunction<AttachFnPtr>(script.module, "AttachDependencyLog"))
+        AttachDependencyLog(nullptr);
+    script.dependencyFiles = static_cast<Array<SmallString>&&>(dependencies.dependencyFiles);
+    script.inputs = static_cast<Array<SmallString>&&>(dependencies.inputs);
+    script.reloaded = false;
+}
+
+// Checks, loads and runs every script. Returns 0 if all of them could be run, 1 otherwise.
+// The trace file is written once every script ran, relative to the project root.
+int RunBuild(Array<BuildScript>& scripts, size_t jobs, const char* traceFile)
+{
+    EnableTrace(traceFile != nullptr);
+
+    FindScripts(scripts);
+    CheckScripts(scripts, jobs);
+    LoadScripts(scripts);
+
+    int exitCode = 0;
+    for (BuildScript& script : scripts)
+    {
+        if (script.module)
+            RunScript(script);
+        else
+            exitCode = 1;
+    }
+
+    if (traceFile)
+    {
+        if (SaveTrace(traceFile))
+            Println("Build timeline written to %s.", traceFile);
+        else
+            Println("Couldn't write the build timeline to %s.", traceFile);
+        EnableTrace(false);
+    }
+    return exitCode;
+}
+
+#ifdef __linux__
+
+// - Resident Runner. "build --daemon" keeps the script modules loaded and recompiles the scripts as soon as they change on disk,
+//   later "build" invocations for the same project hand their request and their stdout and stderr over to it, and wait for its exit code.
+
+StaticString socketFile             = cacheDir / "Runner.sock";                                        // Relative to the project root, like every other path.
+
+struct Request
+{
+    size_t                          jobs;
+    bool                            stop;
+    char                            traceFile[256];                                                     // Empty when no timeline was requested.
+};
+
+int ConnectToRunner()
+{
+    sockaddr_un address = {};
+    address.sun_family = AF_UNIX;
+    memcpy(address.sun_path, socketFile, Length(socketFile));
+
+    int connection = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (connection >= 0 && connect(connection, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0)
+    {
+        close(connection);
+        connection = -1;
+    }
+    return connection;
+}
+
+// Client side: the runner writes straight to our stdout and stderr, so the output keeps its colors and ordering.
+int Forward(int connection, const Request& request)
+{
+    int output[2] = { STDOUT_FILENO, STDERR_FILENO };
+    char control[CMSG_SPACE(sizeof(output))] = {};
+    iovec data = { const_cast<Request*>(&request), sizeof(request) };
+
+    msghdr message = {};
+    message.msg_iov = &data;
+    message.msg_iovlen = 1;
+    message.msg_control = control;
+    message.msg_controllen = sizeof(control);
+
+    cmsghdr* header = CMSG_FIRSTHDR(&message);
+    header->cmsg_level = SOL_SOCKET;
+    header->cmsg_type = SCM_RIGHTS;
+    header->cmsg_len = CMSG_LEN(sizeof(output));
+    memcpy(CMSG_DATA(header), output, sizeof(output));
+
+    fflush(stdout);
+    int exitCode = 1;
+    if (sendmsg(connection, &message, MSG_NOSIGNAL) != static_cast<ssize_t>(sizeof(request)) || recv(connection, &exitCode, sizeof(exitCode), MSG_WAITALL) != sizeof(exitCode))
+    {
+        Println("The resident runner stopped before completing the request.");
+        exitCode = 1;
+    }
+    close(connection);
+    return exitCode;
+}
+
+// Runner side: runs the build with the client's stdout and stderr in place of its own. Returns false if the client asked the runner to stop.
+bool ServeRequest(int listener, Array<BuildScript>& scripts)
+{
+    int connection = accept4(listener, nullptr, nullptr, SOCK_CLOEXEC);
+    if (connection < 0)
+        return true;
+
+    Request request;
+    int output[2] = { -1, -1 };
+    char control[CMSG_SPACE(sizeof(output))] = {};
+    iovec data = { &request, sizeof(request) };
+
+    msghdr message = {};
+    message.msg_iov = &data;
+    message.msg_iovlen = 1;
+    message.msg_control = control;
+    message.msg_controllen = sizeof(control);
 
-    ForEachFile(cacheDir / buildScriptsDir / "*.build", [&] (auto&& script)
+    bool valid = recvmsg(connection, &message, MSG_WAITALL | MSG_CMSG_CLOEXEC) == static_cast<ssize_t>(sizeof(request));
+    cmsghdr* header = CMSG_FIRSTHDR(&message);
+    valid = valid && header && header->cmsg_type == SCM_RIGHTS && header->cmsg_len == CMSG_LEN(sizeof(output));
+    if (header && header->cmsg_type == SCM_RIGHTS)
+        memcpy(output, CMSG_DATA(header), sizeof(output));
+    request.traceFile[sizeof(request.traceFile) - 1] = '\0';
+
+    int exitCode = 1;
+    if (valid && !request.stop)
+    {
+        // Commands started by the scripts inherit the client's stdout and stderr too.
+        fflush(stdout);
+        fflush(stderr);
+        int savedOutput = fcntl(STDOUT_FILENO, F_DUPFD_CLOEXEC, 0);
+        int savedError = fcntl(STDERR_FILENO, F_DUPFD_CLOEXEC, 0);
+        dup2(output[0], STDOUT_FILENO);
+        dup2(output[1], STDERR_FILENO);
+
+        exitCode = RunBuild(scripts, request.jobs ? request.jobs : 1, request.traceFile[0] ? request.traceFile : nullptr);
+
+        fflush(stdout);
+        fflush(stderr);
+        dup2(savedOutput, STDOUT_FILENO);
+        dup2(savedError, STDERR_FILENO);
+        close(savedOutput);
+        close(savedError);
+    }
+    else if (valid)
+        exitCode = 0;
+
+    for (int fd : output)
+        if (fd >= 0)
+            close(fd);
+    send(connection, &exitCode, sizeof(exitCode), MSG_NOSIGNAL);
+    close(connection);
+    return !(valid && request.stop);
+}
+
+int Serve(Array<BuildScript>& scripts, size_t jobs)
+{
+    if (int running = ConnectToRunner(); running >= 0)
+    {
+        close(running);
+        Println("A resident runner is already serving this project.");
+        return 1;
+    }
+
+    // A socket file without a runner behind it was left by one that didn't exit cleanly.
+    unlink(socketFile);
+    sockaddr_un address = {};
+    address.sun_family = AF_UNIX;
+    memcpy(address.sun_path, socketFile, Length(socketFile));
+
+    int listener = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (listener < 0 || bind(listener, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 || listen(listener, 16) != 0)
+    {
+        Println("Couldn't listen on %s.", socketFile.c_str());
+        if (listener >= 0)
+            close(listener);
+        return 1;
+    }
+
+    int watcher = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (watcher < 0 || inotify_add_watch(watcher, buildScriptsDir, IN_CLOSE_WRITE | IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO) < 0)
+        Println("Couldn't watch %s, scripts will only be checked when a build is requested.", buildScriptsDir.c_str());
+
+    // A client going away mid-build must not take the runner with it. A handler rather than SIG_IGN, so that commands don't inherit it.
+    signal(SIGPIPE, [] (int) {});
+
+    FindScripts(scripts);
+    CheckScripts(scripts, jobs);
+    LoadScripts(scripts);
+    Println("Resident runner ready, waiting for builds on %s.", socketFile.c_str());
+    fflush(stdout);
+
+    for (bool running = true; running;)
+    {
+        pollfd events[2] = { { listener, POLLIN, 0 }, { watcher, POLLIN, 0 } };
+        if (poll(events, watcher >= 0 ? 2 : 1, -1) < 0)
+            continue;
+
+        if (events[1].revents & POLLIN)
+        {
+            // Editors save in bursts (temporary file, rename, attributes), wait for the directory to settle before recompiling.
+            alignas(inotify_event) char buffer[4096];
+            do
+                while (read(watcher, buffer, sizeof(buffer)) > 0);
+            while (poll(&events[1], 1, 100) > 0);
+
+            // Only the scripts that changed are recompiled and reloaded, the build itself waits for the next request.
+            FindScripts(scripts);
+            CheckScripts(scripts, jobs);
+            LoadScripts(scripts);
+            fflush(stdout);
+        }
+
+        if (events[0].revents & POLLIN)
+            running = ServeRequest(listener, scripts);
+    }
+
+    UnloadScripts(scripts);
+    if (watcher >= 0)
+        close(watcher);
+    close(listener);
+    unlink(socketFile);
+    Println("Resident runner stopped.");
+    return 0;
+}
+
+// - Watch Mode. "build --watch" runs every script once, then waits for the files their steps read to change, and runs again only the scripts that depend on them.
+//   Inside a script Compile() and Build() skip whatever is still up to date, so only the steps that depend on the changed files run again.
+
+constexpr unsigned watchEvents      = IN_CLOSE_WRITE | IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO;
+
+// A file is identified by the watch on its directory and its name: the kernel reports events that way, whatever path the file was reached through.
+uint64 WatchKey(int watch, const char* name)
+{
+    return TraumaBuildSystem::Helpers::Hash(name, strlen(name), static_cast<uint64>(watch));
+}
+
+// Watches the directory of every source, header and input the script's last run read.
+void WatchInputs(BuildScript& script, int watcher)
+{
+    auto AddWatch = [&] (const SmallString& file)
+    {
+        const char* name = file.c_str();
+        for (const char* p = name; *p != '\0'; p++)
+            if (*p == '/')
+                name = p + 1;
+
+        // Watching the same directory again returns the same watch.
+        SmallString directory = name == file.c_str() ? SmallString(".") : SmallString(file.c_str(), static_cast<size_t>(name - file.c_str()));
+        int watch = inotify_add_watch(watcher, directory.c_str(), watchEvents);
+        if (watch < 0)
+            return true;
+
+        script.watched.push(WatchKey(watch, name));
+        bool known = false;
+        for (int scriptWatch : script.watches)
+            known = known || scriptWatch == watch;
+        if (!known)
+            script.watches.push(watch);
+        return true;
+    };
+
+    script.watched.clear();
+    script.watches.clear();
+    for (const SmallString& input : script.inputs)
+        AddWatch(input);
+    for (const SmallString& dependencyFile : script.dependencyFiles)
+    {
+        auto [dependencies, dependenciesSize] = ReadFile(dependencyFile);
+        if (dependencies)
+        {
+            TraumaBuildSystem::Helpers::ForEachDependency(dependencies, AddWatch);
+            free(dependencies);
+        }
+    }
+}
+
+// Removes the watches in active that no script uses any more, then makes active the watches of every script.
+void PruneWatches(const Array<BuildScript>& scripts, int watcher, Array<int>& active)
+{
+    auto Used = [&] (int watch)
+    {
+        for (const BuildScript& script : scripts)
+            for (int scriptWatch : script.watches)
+                if (scriptWatch == watch)
+                    return true;
+        return false;
+    };
+
+    for (int watch : active)
+        if (!Used(watch))
+            inotify_rm_watch(watcher, watch);
+
+    active.clear();
+    for (const BuildScript& script : scripts)
+        for (int watch : script.watches)
+        {
+            bool known = false;
+            for (int activeWatch : active)
+                known = known || activeWatch == watch;
+            if (!known)
+                active.push(watch);
+        }
+}
+
+// Reads the pending events. Changes to files are appended to changes, or dropped if it's nullptr.
+void ReadEvents(int watcher, int scriptsWatch, Array<uint64>* changes, bool& scriptsChanged)
+{
+    alignas(inotify_event) char buffer[4096];
+    for (ssize_t size; (size = read(watcher, buffer, sizeof(buffer))) > 0;)
+        for (char* p = buffer; p < buffer + size; p += sizeof(inotify_event) + reinterpret_cast<inotify_event*>(p)->len)
+        {
+            auto* event = reinterpret_cast<inotify_event*>(p);
+            if (event->wd == scriptsWatch)
+                scriptsChanged = true;
+            else if (event->len > 0 && changes)
+                changes->push(WatchKey(event->wd, event->name));
+        }
+}
+
+int Watch(Array<BuildScript>& scripts, size_t jobs)
+{
+    int watcher = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    int scriptsWatch = watcher >= 0 ? inotify_add_watch(watcher, buildScriptsDir, watchEvents) : -1;
+    if (scriptsWatch < 0)
+    {
+        Println("Couldn't watch %s.", buildScriptsDir.c_str());
+        if (watcher >= 0)
+            close(watcher);
+        return 1;
+    }
+
+    RunBuild(scripts, jobs, nullptr);
+    Array<int> activeWatches;
+    for (BuildScript& script : scripts)
+        WatchInputs(script, watcher);
+    PruneWatches(scripts, watcher, activeWatches);
+    Println("=== Watching for Changes ===");
+    fflush(stdout);
+
+    Array<uint64> changes;
+    bool scriptsChanged = false;
+    while (true)
+    {
+        pollfd events = { watcher, POLLIN, 0 };
+        if (!scriptsChanged && poll(&events, 1, -1) <= 0)
+            continue;
+
+        // Editors and checkouts write in bursts, the whole burst is handled at once when the tree has been quiet for a moment.
+        changes.clear();
+        do
+            ReadEvents(watcher, scriptsWatch, &changes, scriptsChanged);
+        while (poll(&events, 1, 100) > 0);
+
+        if (scriptsChanged)
+        {
+            FindScripts(scripts);
+            CheckScripts(scripts, jobs);
+            LoadScripts(scripts);
+            scriptsChanged = false;
+        }
+
+        // Only the files some script read matter. Whatever else happens in the watched directories, like the objects and dependency
+        // files Compile() writes next to the sources, is dropped before it can reach the scripts that recorded nothing.
+        for (size_t i = 0; i < changes.size();)
+        {
+            bool watched = false;
+            for (const BuildScript& script : scripts)
+                for (uint64 key : script.watched)
+                    watched = watched || key == changes[i];
+
+            if (watched)
+                i++;
+            else
+            {
+                changes[i] = changes.back();
+                changes.pop();
+            }
+        }
+
+        // A script that recorded nothing builds through commands TBS can't see into, so any change to a file the others read may concern it.
+        uint64 startTime = TraumaBuildSystem::Helpers::MonotonicTime();
+        size_t runs = 0;
+        for (BuildScript& script : scripts)
+        {
+            bool affected = script.reloaded || (script.watched.is_empty() && !changes.is_empty());
+            for (size_t i = 0; i < changes.size() && !affected; i++)
+                for (uint64 watched : script.watched)
+                    affected = affected || watched == changes[i];
+            if (!affected || !script.module)
+                continue;
+
+            RunScript(script);
+            WatchInputs(script, watcher);
+            runs++;
+        }
+
+        // The events the scripts caused by writing into watched directories are drained, or a script generating one of its own inputs would run forever.
+        if (runs > 0)
+            ReadEvents(watcher, scriptsWatch, nullptr, scriptsChanged);
+        PruneWatches(scripts, watcher, activeWatches);
+
+        if (runs > 0)
+            Println("=== Rebuilt %zu script(s) in %.2fs, Watching for Changes ===", runs, static_cast<double>(TraumaBuildSystem::Helpers::MonotonicTime() - startTime) / 1e9);
+        fflush(stdout);
+    }
+}
+
+#endif
+
+int main(int argc, char** argv)
+{
+    // Usage: build [-j<jobs>] [--trace=<file>] [--daemon | --stop | --watch] [projectRoot]
+    // --daemon starts a resident runner for the project, and --stop stops it. While one runs, builds are forwarded to it.
+    // --watch builds, then keeps building what the changed files affect until interrupted.
+    size_t jobs = TraumaBuildSystem::Platform::HardwareThreadCount();
+    const char* traceFile = nullptr;
+    bool daemon = false;
+    bool stop = false;
+    bool watch = false;
+    for (int i = 1; i < argc; i++)
     {
-        DynamicLibrary library = TraumaBuildSystem::Platform::LoadLibrary(cacheDir / buildScriptsDir / script);
-        Println("=== Build Process Started: %s ===", script.c_str());
-        TraumaBuildSystem::Platform::GetFunction(library, "BuildSteps")();
-        TraumaBuildSystem::Platform::FreeLibrary(library);
-        Println("=== Build Process Terminated: %s ===\n", script.c_str());
-    });
+        if (strncmp(argv[i], "-j", 2) == 0)
+            jobs = strtoull(argv[i] + 2, nullptr, 10);
+        else if (strncmp(argv[i], "--trace=", 8) == 0)
+            traceFile = argv[i] + 8;
+        else if (strcmp(argv[i], "--daemon") == 0)
+            daemon = true;
+        else if (strcmp(argv[i], "--stop") == 0)
+            stop = true;
+        else if (strcmp(argv[i], "--watch") == 0)
+            watch = true;
+        else if (IsValidPath(argv[i]))
+            CurrentWorkingDirectory(argv[i]);
+    }
+    if (jobs == 0)
+        jobs = 1;
+
+    if (NotExists(cacheDir / buildScriptsDir))
+        CreateDirectory(cacheDir / buildScriptsDir);
+
+    #ifdef __linux__
+        if (!daemon && !watch)
+        {
+            int connection = ConnectToRunner();
+            if (connection >= 0)
+            {
+                Request request = { jobs, stop, {} };
+                if (traceFile)
+                    strncpy(request.traceFile, traceFile, sizeof(request.traceFile) - 1);
+                return Forward(connection, request);
+            }
+        }
+        if (stop)
+        {
+            Println("No resident runner is serving this project.");
+            return 1;
+        }
+    #else
+        if (daemon || stop || watch)
+        {
+            Println("The resident runner and watch mode are only available on Linux.");
+            return 1;
+        }
+    #endif
+
+    Array<BuildScript> scripts;
+    LoadFingerprints(fingerprintsFile);
+
+    #ifdef __linux__
+        if (daemon)
+            return Serve(scripts, jobs);
+        if (watch)
+            return Watch(scripts, jobs);
+    #endif
+
+    int exitCode = RunBuild(scripts, jobs, traceFile);
+    UnloadScripts(scripts);
+    return exitCode;
 }
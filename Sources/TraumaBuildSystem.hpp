@@ -10,19 +10,30 @@
 
 #pragma once
 #define TBS_InjectFile
-#define BUILD_STEPS() extern "C" void BuildSteps()
+// AttachTrace() lets the runner hand its build timeline over to the script, see EnableTrace().
+#define BUILD_STEPS() \
+    extern "C" void AttachTrace(void* trace) { TraumaBuildSystem::Helpers::gTrace = static_cast<TraumaBuildSystem::Helpers::TraceLog*>(trace); } \
+    extern "C" void AttachDependencyLog(void* log) { TraumaBuildSystem::Helpers::gDependencies = static_cast<TraumaBuildSystem::Helpers::DependencyLog*>(log); } \
+    extern "C" void BuildSteps()
 #define TRAUMA_BUILD_SYSTEM(ver) \
     using namespace TraumaBuildSystem::ver; \
-    using TraumaBuildSystem::String;
+    using TraumaBuildSystem::String; \
+    using TraumaBuildSystem::Array; \
+    using TraumaBuildSystem::Path; \
+    using TraumaBuildSystem::SmallString;
 
-using size_t = unsigned long long;      static_assert(sizeof(size_t) == 8);
+using size_t = decltype(sizeof(0));     static_assert(sizeof(size_t) == 8);
 using uint16 = unsigned short;          static_assert(sizeof(uint16) == 2);
+using uint64 = unsigned long long;      static_assert(sizeof(uint64) == 8);
 
 // You can skip this part -> //////////////////////////////
 namespace TraumaBuildSystem
 {
     struct FileData;
     template <size_t> class String;
+    template <typename> class Array;
+    class Path;
+    class SmallString;
 }
 // You can skip this part <- //////////////////////////////
 
@@ -39,7 +50,7 @@ namespace TraumaBuildSystem
 
 namespace TraumaBuildSystem::v1::Experimental
 {
-    // - As* functions manipulate input according to the function called. All As* functions return a String.
+    // - As* functions manipulate input according to the function called. All As* functions return a String, or a SmallString when the size of input isn't known at compile time.
     // Compiler Options Helpers.
     constexpr auto                  AsInclude(const auto& path);                                        // Prefix path so Use this path when resolving includes.
     constexpr auto                  AsSystemInclude(const auto& path);                                  // Use this path when resolving includes, but threat them like system headers. (Suppresses Warnings)
@@ -60,26 +71,62 @@ namespace TraumaBuildSystem::v1::Experimental
     // - Path Validation.
     bool                            Exists(const auto& path);                                           // Returns true if Path exists.
     bool                            NotExists(const auto& path);                                        // Return true if Path does NOT exist.
+    uint64                          LastModificationTime(const auto& path);                             // Returns the last time Path was written to, 0 if it doesn't exist. Only meaningful when compared to other values returned by this function.
     constexpr bool                  IsValidPath(const auto& path);                                      // TODO: Currently always returns true.
     constexpr bool                  IsAbsolutePath(const auto& path);                                   // TODO: Currently always returns false.
     constexpr bool                  IsRelativePath(const auto& path);                                   // TODO: Currently always returns false.
 
+    // - File System Cache. Off by default. While enabled, Exists(), NotExists(), LastModificationTime(), Fingerprint() and ForEachFile() remember what the file system answered,
+    //   so asking again about the same path costs a hash lookup. Changes made through TBS keep it up to date, and it's cleared whenever an external program terminates.
+    void                            EnableFileSystemCache(bool enable = true);                          // Turns the cache on or off, it starts empty either way. Must not be called while other threads are using TBS.
+    void                            InvalidateFileSystemCache();                                        // Forgets everything the cache learned, use it after files were changed behind TBS's back.
+
+    // - Build Timeline. Off by default. While enabled, every Call(), Compile(), Build() and, in the runner, every script compile and BuildSteps() is recorded
+    //   with its start and end time, job slot, exit code and command line. Run the runner with --trace=<file> to record a whole build.
+    void                            EnableTrace(bool enable = true);                                    // Turns recording on or off, it starts empty either way.
+    bool                            SaveTrace(const auto& filename);                                    // Writes what was recorded so far as Chrome trace-event JSON, for chrome://tracing or ui.perfetto.dev. Returns true on success.
+
     // - Directory Operations.
     bool                            CreateDirectory(const auto& path);                                  // Creates a directory, including the intermediates if needed. Returns true on success.
-    bool                            DeleteDirectory(const auto& path);                                  // Deletes a directory and all its content recursively. Returns true on success.
+    bool                            DeleteDirectory(const auto& path);                                  // Deletes a directory and all its content recursively, several subdirectories at a time. Returns true on success.
+    bool                            DeleteDirectoryAsync(const auto& path);                             // Moves a directory to a hidden sibling and returns, a detached process deletes it from there. Returns true once path is gone.
+    bool                            CopyDirectory(const auto& fromPath, const auto& toPath);            // Copies a directory and all its content into toPath, several files at a time. Files of toPath with the same size, and the same modification time or content, are kept. Returns true on success.
 
-    auto                            CurrentWorkingDirectory();                                          // Returns a String of the Current Working Directory.
-    bool                            CurrentWorkingDirectory(const auto& path);                          // Sets the Current Working Directory to the new Path. Returns true on success.
+    auto                            CurrentWorkingDirectory();                                          // Returns a SmallString of the Current Working Directory, or of the calling thread's directory if it has one.
+    bool                            CurrentWorkingDirectory(const auto& path);                          // Sets the Current Working Directory to the new Path, for every thread. Returns true on success.
+
+    // - Thread Context. The working directory and the environment are shared by every thread of the process. A thread can have its own instead: relative paths it passes
+    //   to TBS are resolved against its directory, and the commands it launches start there with its environment, without affecting other threads.
+    //   Threads started by TBS, like the workers of a Scheduler, get the context of the thread that started them.
+    bool                            SetThreadDirectory(const auto& path);                               // Sets the calling thread's directory, path being relative to its current one. Returns true on success.
+    void                            ResetThreadDirectory();                                             // The calling thread goes back to the process's working directory.
+    void                            SetThreadEnvironment(const char* const name, const char* const value); // Sets name for the commands launched by the calling thread, or removes it if value is nullptr. On Windows, commands given as a plain string only get the directory.
+    void                            ResetThreadEnvironment();                                           // Commands launched by the calling thread get the process's environment again.
 
     // - File Operations.
     bool                            DeleteFile(const auto& filename);                                   // Deletes a single file. Returns True on success.
-    bool                            CopyFile(const auto& fromPath, const auto& toPath);                 // Copies a single file. Returns True on success.
+    bool                            CopyFile(const auto& fromPath, const auto& toPath);                 // Copies a single file, creating the directories of toPath if needed. Where the file system supports it the content is shared rather than copied. Returns True on success.
     void                            ForEachFile(const auto& path, auto&& fn);                           // Executes function fn for each file in path. Path can contain Wildcards files will be filtered accordingly. (Ex: MyPath/*.txt)
+    void                            FindFiles(const auto& path, Array<SmallString>& files);             // Like ForEachFile(), but appends the path of each file, its directory included, to files.
     FileData                        ReadFile(const auto& filename);                                     // Reads an entire file into a buffer and returns a char* handle and its size in a FileData struct. On Error, the buffer is set to nullptr. IT IS THE USER'S RESPONSIBILITY TO FREE() THE BUFFER HANDLE.
+    class MappedFile;                                                                                   // A read-only view of a file's content that releases itself, without a copy for large files. See its definition for details.
+
+    // - File Fingerprints. A fingerprint is a hash of a file's content: unlike modification times, it only changes when the content does.
+    uint64                          Fingerprint(const auto& filename);                                  // Returns the fingerprint of filename, 0 if it can't be read. Files whose size, modification time and inode didn't change since they were hashed are not read again.
+    void                            Fingerprint(const auto* filenames, size_t count, uint64* fingerprints); // Like Fingerprint(), for a batch of files hashed in parallel.
+    bool                            LoadFingerprints(const auto& filename);                             // Loads the fingerprints saved by SaveFingerprints(), so that files unchanged since then are not hashed again. Returns true on success.
+    bool                            SaveFingerprints(const auto& filename);                             // Saves every fingerprint computed or loaded so far. Returns true on success.
+
+    // - Launch External Programs. On Windows THIS CURRENTLY USES system() WHICH IS NOTORIOUSLY UNSAFE, on Linux cmd is split into arguments and launched directly, without a shell.
+    //   cmd can also be a CommandLine, whose arguments are passed to the program as they are. See its definition for details.
+    class CommandLine;
 
-    // - Launch External Programs. THIS CURRENTLY USES system() WHICH IS NOTORIOUSLY UNSAFE.
     void                            Call(const auto& cmd);                                              // Executes cmd.
-    void                            Call(const auto& cmd, auto& output);                                // Executes cmd and captures the output.
+    template <size_t Size>
+    void                            Call(const auto& cmd, String<Size>& output);                        // Executes cmd and captures the output, truncated to fit output. The trailing newline is dropped.
+    int                             Call(const auto& cmd, Array<char>& output);                         // Executes cmd and appends its whole output to output, which is kept null terminated. Returns the exit code.
+    int                             CallStreaming(const auto& cmd, auto&& fn);                          // Executes cmd, calling fn(const char* data, size_t size) for each chunk of output as soon as it's read. Returns the exit code.
+    int                             CallStreamingLines(const auto& cmd, auto&& fn);                     // Like CallStreaming(), but fn receives one line at a time, without its line terminator.
 
     // - Console Functionality.
     void                            ClearConsole();                                                     // This is basicaly a shortcut for Call("cls");
@@ -88,8 +135,39 @@ namespace TraumaBuildSystem::v1::Experimental
     void                            Println();                                                          // Prints a newline. (AKA printf("\n"))
 
     // - Automations for Call(), not very useful for now.
-    auto                            Compile(const auto &sourceFile, const auto& compilerFlags, const auto& includes);
-    bool                            Build(const auto& artifact, const auto& source, const auto& compilerFlags, const auto& linkerFlags, const auto& includes, const auto& libsPath, const auto& libs);
+    auto                            Compile(const auto &sourceFile, const auto& compilerFlags, const auto& includes);    // Compiles sourceFile to sourceFile.o, unless the object is newer than all its dependencies and was built with the same command line.
+    bool                            Build(const auto& artifact, const auto& source, const auto& compilerFlags, const auto& linkerFlags, const auto& includes, const auto& libsPath, const auto& libs);    // Returns true if the compiler succeeded.
+
+    // - Object Cache. Off by default. While enabled, Compile() keeps a copy of every object it builds, keyed on the compiler's identity, the command line and the content of the source
+    //   and of every header it included. An object that has to be rebuilt is restored from the cache along with its diagnostics when its key is found, without running the compiler.
+    bool                            EnableObjectCache(const auto& directory);                           // Turns the cache on, keeping objects in directory, which is shared safely by concurrent builds. Returns false if directory can't be created.
+    void                            DisableObjectCache();
+
+    // - Job Scheduling. A Scheduler runs external commands in parallel, honouring the dependencies between them. See its definition for details.
+    using JobId = size_t;
+    class Scheduler;
+
+    JobId                           Compile(Scheduler& scheduler, const auto &sourceFile, const auto& compilerFlags, const auto& includes);     // Like Compile(), but queues the compiler on scheduler. Up to date objects get a job that does nothing.
+    JobId                           Build(Scheduler& scheduler, const auto& artifact, const auto& source, const auto& compilerFlags, const auto& linkerFlags, const auto& includes, const auto& libsPath, const auto& libs);   // Like Build(), but queues the compiler on scheduler.
+
+    // - Multi-Source Builds. Each source is compiled to its own object in objectDirectory, like Compile() does, then a single link produces artifact.
+    //   Use one objectDirectory per configuration. The link is skipped when no object changed, artifact exists and was linked with the same command line.
+    //   compilerFlags and includes are passed to the compiler, linkerFlags, libsPath and libs to the linker.
+    bool                            Build(const auto& artifact, const auto& objectDirectory, const auto* sourceFiles, size_t count, const auto& compilerFlags, const auto& linkerFlags, const auto& includes, const auto& libsPath, const auto& libs); // Compiles in parallel, then links. Returns true if every step succeeded.
+    JobId                           Build(Scheduler& scheduler, const auto& artifact, const auto& objectDirectory, const auto* sourceFiles, size_t count, const auto& compilerFlags, const auto& linkerFlags, const auto& includes, const auto& libsPath, const auto& libs); // Like Build(), but queues the compilers and the linker on scheduler. Returns the link job.
+
+    // - Unity Builds. Sources are sorted by path and grouped into batches, each one compiled with Compile() as a single generated translation unit that #includes them.
+    //   A batch ends after a source picked by the hash of its path, so adding or removing a source only changes its own batch, and editing one changes none.
+    bool                            CompileUnity(const auto& unityDirectory, const auto* sourceFiles, size_t count, size_t batchSize, const auto& compilerFlags, const auto& includes, Array<SmallString>& objects); // Compiles batches of batchSize sources on average in parallel, generating them in unityDirectory and appending their objects to objects. Returns true if every batch compiled.
+    JobId                           CompileUnity(Scheduler& scheduler, const auto& unityDirectory, const auto* sourceFiles, size_t count, size_t batchSize, const auto& compilerFlags, const auto& includes, Array<SmallString>& objects); // Like CompileUnity(), but queues the compilers on scheduler. The returned job succeeds once every batch compiled.
+
+    // - Asynchronous Processes. While waiting on any process, the output of every running one is collected, so children never stall on a full pipe.
+    class Process;
+
+    Process                         Spawn(const auto& cmd, bool captureOutput = true);                  // Launches cmd without waiting for it. If captureOutput is set, stdout and stderr are collected in the returned Process.
+    int                             Wait(Process& process);                                             // Waits for process to terminate and returns its exit code, -1 if it couldn't be launched.
+    bool                            TryWait(Process& process, int& exitCode);                           // Like Wait(), but returns false instead of blocking if process is still running.
+    size_t                          WaitAny(Process* processes, size_t count);                          // Waits for any of processes to terminate and returns its index. Processes already waited on are skipped, returns count if none is left.
 
     // TODO: Change this so that extensions can be specified when compiling TBS. Code for enabled extensions will be injected here using InjectFile.
     // - SVN Extension.
@@ -121,6 +199,15 @@ namespace TraumaBuildSystem::v1::Experimental
 TBS_InjectFile
 #include "String.hpp"
 
+TBS_InjectFile
+#include "Array.hpp"
+
+TBS_InjectFile
+#include "Path.hpp"
+
+TBS_InjectFile
+#include "SmallString.hpp"
+
 // ====================================================================Current
 // ------------------------------ IMPLEMENTATION ------------------------------
 // ============================================================================
@@ -128,12 +215,17 @@ TBS_InjectFile
 
 // TODO: Remove Dependencies from CRT
 #include <cstdio>
+#include <cstdlib>
 #include <cstring>
+#include <cstdarg>
 #include <cassert>
 
 TBS_InjectFile
 #include "TypeTraits.hpp"
 
+TBS_InjectFile
+#include "Hash.hpp"
+
 #ifdef _WIN32
     namespace Windows
     {
@@ -142,6 +234,9 @@ TBS_InjectFile
     }
 
     using DynamicLibrary = Windows::HMODULE;
+    using ThreadHandle = Windows::HANDLE;
+    using MutexHandle = Windows::SRWLOCK;
+    using ConditionHandle = Windows::CONDITION_VARIABLE;
 
     #undef CreateDirectory
     #undef GetCurrentDirectory
@@ -151,6 +246,31 @@ TBS_InjectFile
     #undef DeleteFile
     #undef SHFileOperation
     #undef CreateProcess
+#elif defined(__linux__)
+    // POSIX headers can't be wrapped in a namespace like <windows.h>: the CRT headers above already pulled parts of them in.
+    #include <errno.h>
+    #include <dlfcn.h>
+    #include <dirent.h>
+    #include <fcntl.h>
+    #include <fnmatch.h>
+    #include <poll.h>
+    #include <pthread.h>
+    #include <sched.h>
+    #include <spawn.h>
+    #include <time.h>
+    #include <unistd.h>
+    #include <linux/fs.h>
+    #include <sys/eventfd.h>
+    #include <sys/ioctl.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <sys/syscall.h>
+    #include <sys/wait.h>
+
+    using DynamicLibrary = void*;
+    using ThreadHandle = pthread_t;
+    using MutexHandle = pthread_mutex_t;
+    using ConditionHandle = pthread_cond_t;
 #else
     #error Platform not supported
 #endif
@@ -168,8 +288,129 @@ namespace TraumaBuildSystem
 
 
 
+namespace TraumaBuildSystem::v1::Experimental
+{
+    /*  The arguments of an external program, kept one after the other in a single buffer along with the offset of each one.
+        Arguments reach the program exactly as they were added: no shell parses them on the way, so they never need quotes
+        or escapes, and their length is only limited by memory. When they don't fit what the platform accepts on a command line,
+        every argument but the program is moved to a temporary response file (@file), which GCC, Clang and binutils understand.
+    */
+    class CommandLine
+    {
+        // ============================================================ Constructors / Destructors / Operators
+
+        public:
+
+        #ifdef _WIN32
+            static constexpr size_t     MaxLength                       = 8191;                         // cmd.exe's limit, popen() goes through it.
+        #else
+            static constexpr size_t     MaxLength                       = 128 * 1024;                   // A single argument can't be longer than this, the response file is one.
+        #endif
+
+        CommandLine() = default;
+        explicit CommandLine(const char* const program)                 { add(program); }
+        CommandLine(CommandLine&&) = default;
+
+        CommandLine&                    operator=(CommandLine&&) = default;
+
+        const char*                     operator[](size_t index) const  { return mArguments.data() + mOffsets[index]; }
+
+        // ============================================================ Functions
+
+        public:
+
+        CommandLine&                    add(const auto& argument);                                      // Adds argument as it is. A CommandLine argument adds all of its arguments.
+        CommandLine&                    add(const auto& prefix, const auto& argument);                  // Adds prefix and argument joined as a single argument, for options like -I<path>.
+        CommandLine&                    add_split(const auto& arguments);                               // Splits arguments at blanks, quotes group and a backslash escapes the next character, then adds each one. Meant for flags kept in a String.
+        void                            clear()                         { mArguments.clear(); mOffsets.clear(); }
+
+        size_t                          size() const                    { return mOffsets.size(); }     // Number of arguments, the program included.
+        bool                            is_empty() const                { return mOffsets.is_empty(); }
+        const char*                     data() const                    { return mArguments.data(); }   // Every argument, each one null terminated.
+        size_t                          length() const                  { return mArguments.size(); }   // Size of data(), terminators included.
+
+        void                            join(Array<char>& commandLine, size_t firstArgument = 0) const; // Appends the arguments as a single null terminated line, quoted where needed with the conventions of the platform's shell.
+
+        // ============================================================ Data
+
+        private:
+
+        Array<char>                     mArguments;
+        Array<size_t>                   mOffsets;
+    };
+
+
+
+    /*  A read-only view of a whole file, released along with the MappedFile. Large files are mapped in memory: their pages are read
+        as they are touched, straight from the page cache, and nothing is copied. Small files cost less to read in a single call,
+        into a buffer the MappedFile owns. Either way the content is not null terminated, and an empty file is open with no data.
+        A mapped file that is changed by someone else while it's open may show the change.
+    */
+    class MappedFile
+    {
+        // ============================================================ Constructors / Destructors / Operators
+
+        public:
+
+        static constexpr size_t         MapThreshold                    = 64 * 1024;                    // Files smaller than this are read rather than mapped.
+
+        MappedFile() = default;
+        explicit MappedFile(const auto& filename)                       { open(filename); }
+        MappedFile(MappedFile&& other)                                  : mData(other.mData), mSize(other.mSize), mMapped(other.mMapped), mOpen(other.mOpen) { other.mData = nullptr; other.mSize = 0; other.mMapped = false; other.mOpen = false; }
+        ~MappedFile()                                                   { close(); }
+
+        MappedFile&                     operator=(MappedFile&& other);
+
+        // ============================================================ Functions
+
+        public:
+
+        bool                            open(const auto& filename);     // Closes the current file, then opens filename. Returns true on success.
+        void                            close();
+
+        bool                            is_open() const                 { return mOpen; }
+        bool                            is_empty() const                { return mSize == 0; }
+        const char*                     data() const                    { return mData; }               // nullptr for an empty file.
+        size_t                          size() const                    { return mSize; }
+        const char*                     begin() const                   { return mData; }
+        const char*                     end() const                     { return mData + mSize; }
+
+        // ============================================================ Data
+
+        private:
+
+        char*                           mData                           = nullptr;
+        size_t                          mSize                           = 0;
+        bool                            mMapped                         = false;                        // Otherwise mData was allocated with malloc().
+        bool                            mOpen                           = false;
+    };
+}
+
+
+
 namespace TraumaBuildSystem::Helpers
 {
+    // The calling thread's directory and environment, see SetThreadDirectory(). The directory is absolute and has no symbolic links, like a working directory.
+    struct ThreadContext
+    {
+        SmallString                     directory;                                                      // Empty while the thread uses the process's working directory.
+        Array<SmallString>              environment;                                                    // NAME=value to set a variable, NAME alone to remove it.
+        #ifdef __linux__
+            int                         directoryFd                     = AT_FDCWD;                     // directory opened with O_PATH, the base of every *at() call.
+        #endif
+
+        ~ThreadContext();
+    };
+
+    inline thread_local ThreadContext   gThreadContext;
+
+    SmallString                     ToThreadPath(const char* const path);                               // Returns path resolved against the calling thread's directory, for the APIs that don't take a base directory. Absolute paths are returned unchanged.
+    FILE*                           OpenFile(const char* const filename, const char* const mode);       // Like fopen(), relative to the calling thread's directory.
+    #ifdef _WIN32
+        SmallString                     ToShellCommand(const char* const cmd);                          // Prefixes cmd with a change to the calling thread's directory, for commands run through cmd.exe.
+        Windows::LPWSTR                 ToEnvironmentBlock();                                           // Returns the environment with the calling thread's changes, for CreateProcessW(). Returns nullptr if there are none, otherwise it must be freed.
+    #endif
+
     template <size_t aSize, size_t bSize>
     inline constexpr auto StrCat(const char (&a)[aSize], const String<bSize>& b) { return a + b; }
 
@@ -185,6 +426,9 @@ namespace TraumaBuildSystem::Helpers
         return string;
     }
 
+    inline SmallString StrCat(const SmallString& a, const char* const b)                        { return a + b; }
+    inline SmallString StrCat(const char* const a, const SmallString& b)                        { return a + b; }
+
     inline constexpr const char* ToCStr(const auto& string)                                     { return string.c_str(); }
     inline constexpr const char* ToCStr(const char* const string)                               { return string; }
     inline constexpr const char* ToCStr(char* const string)                                     { return string; }
@@ -195,31 +439,219 @@ namespace TraumaBuildSystem::Helpers
     template <size_t Size>
     inline consteval size_t StrLen(const char (&string)[Size])                                  { return Size; }
 
+    inline constexpr bool IsBlank(char c)                                                       { return c == ' ' || c == '\t' || c == '\n' || c == '\r'; }
+
+    // Sorts values in place, less(a, b) tells whether a goes before b. Heap sort: no allocations and no quadratic worst case.
+    template <typename T>
+    inline void Sort(T* values, size_t count, auto&& less)
+    {
+        auto Swap = [] (T& a, T& b)
+        {
+            T t = static_cast<T&&>(a);
+            a = static_cast<T&&>(b);
+            b = static_cast<T&&>(t);
+        };
+
+        auto SiftDown = [&] (size_t root, size_t end)
+        {
+            for (size_t child = root * 2 + 1; child < end; root = child, child = root * 2 + 1)
+            {
+                if (child + 1 < end && less(values[child], values[child + 1]))
+                    child++;
+                if (!less(values[root], values[child]))
+                    return;
+                Swap(values[root], values[child]);
+            }
+        };
+
+        for (size_t i = count / 2; i > 0; i--)
+            SiftDown(i - 1, count);
+        for (size_t end = count; end > 1; end--)
+        {
+            Swap(values[0], values[end - 1]);
+            SiftDown(0, end - 1);
+        }
+    }
+
+    inline constexpr String<17> ToHexString(uint64 value)
+    {
+        String<17> string;
+        for (size_t i = 0; i < 16; i++)
+            string[15 - i] = "0123456789abcdef"[(value >> (i * 4)) & 0xf];
+        return string;
+    }
+
+    // Calls fn(const SmallString& path) for each prerequisite of dependencies, a Makefile rule as written by the compiler's -MMD, until fn returns false.
+    inline void ForEachDependency(const char* const dependencies, auto&& fn)
+    {
+        // Skip the rule's target, the colon of a drive letter isn't followed by a blank.
+        const char* p = dependencies;
+        while (*p != '\0' && !(*p == ':' && (IsBlank(p[1]) || p[1] == '\0')))
+            p++;
+        if (*p == ':')
+            p++;
+
+        SmallString dependency;
+        while (true)
+        {
+            bool endOfFile = *p == '\0';
+            if (*p == '\\' && (p[1] == '\n' || (p[1] == '\r' && p[2] == '\n')))
+                p += p[1] == '\r' ? 3 : 2;
+            else if (!endOfFile && !IsBlank(*p))
+            {
+                // Escaped blanks and dollars are part of the path.
+                bool escaped = (*p == '\\' && p[1] == ' ') || (*p == '$' && p[1] == '$');
+                dependency.push(escaped ? p[1] : *p);
+                p += escaped ? 2 : 1;
+                continue;
+            }
+            else if (!endOfFile)
+                p++;
+
+            if (!dependency.is_empty())
+            {
+                if (!fn(dependency))
+                    return;
+                dependency.clear();
+            }
+
+            if (endOfFile)
+                return;
+        }
+    }
+
+    // Checks whether object has to be rebuilt. commandFile stores the hash of the command line that produced object,
+    // dependencyFile is a Makefile rule as written by the compiler's -MMD. If object is out of date, reason explains why.
+    inline bool IsUpToDate(const auto& object, const auto& dependencyFile, const auto& commandFile, const auto& commandHash, auto& reason)
+    {
+        using namespace v1::Experimental;
+
+        uint64 objectTime = LastModificationTime(object);
+        if (objectTime == 0)
+        {
+            reason = "no previous output";
+            return false;
+        }
+
+        auto [storedHash, storedHashSize] = ReadFile(commandFile);
+        bool sameCommand = storedHash && strcmp(storedHash, commandHash) == 0;
+        free(storedHash);
+        if (!sameCommand)
+        {
+            reason = "command line changed";
+            return false;
+        }
+
+        auto [dependencies, dependenciesSize] = ReadFile(dependencyFile);
+        if (!dependencies)
+        {
+            reason = "no dependency information";
+            return false;
+        }
+
+        bool upToDate = true;
+        ForEachDependency(dependencies, [&] (const SmallString& dependency)
+        {
+            if (uint64 dependencyTime = LastModificationTime(dependency);
+                dependencyTime == 0 || dependencyTime > objectTime)
+            {
+                reason = dependency;
+                reason.append(dependencyTime == 0 ? " is missing" : " changed");
+                upToDate = false;
+            }
+            return upToDate;
+        });
+        free(dependencies);
+
+        return upToDate;
+    }
+
+    // Writes the arguments of cmd from firstArgument on to a new temporary file, in the format GCC expects in @file arguments.
+    // Returns the name of the file, which the caller must pass to DeleteResponseFile() once the program exited. Returns nullptr on failure.
+    inline char* WriteResponseFile(const v1::Experimental::CommandLine& cmd, size_t firstArgument)
+    {
+        // Each argument on its own line: blanks, quotes and backslashes are escaped with a backslash.
+        Array<char> content;
+        content.reserve(cmd.length() + cmd.length() / 8);
+        for (size_t i = firstArgument; i < cmd.size(); i++)
+        {
+            const char* argument = cmd[i];
+            if (*argument == '\0')
+            {
+                content.push('\"');
+                content.push('\"');
+            }
+            for (const char* p = argument; *p != '\0'; p++)
+            {
+                if (IsBlank(*p) || *p == '\'' || *p == '\"' || *p == '\\')
+                    content.push('\\');
+                content.push(*p);
+            }
+            content.push('\n');
+        }
+
+        #ifdef _WIN32
+            char directory[MAX_PATH + 1];
+            auto filename = static_cast<char*>(malloc(MAX_PATH + 1));
+            if (Windows::GetTempPathA(sizeof(directory), directory) == 0 || Windows::GetTempFileNameA(directory, "tbs", 0, filename) == 0)
+            {
+                free(filename);
+                return nullptr;
+            }
+            FILE* f = fopen(filename, "wb");
+        #elif defined(__linux__)
+            const char* directory = getenv("TMPDIR");
+            if (!directory || *directory == '\0')
+                directory = "/tmp";
+
+            size_t directoryLength = Length(directory);
+            auto filename = static_cast<char*>(malloc(directoryLength + sizeof("/tbs-XXXXXX.rsp")));
+            memcpy(filename, directory, directoryLength);
+            memcpy(filename + directoryLength, "/tbs-XXXXXX.rsp", sizeof("/tbs-XXXXXX.rsp"));
+            int fd = mkostemps(filename, 4, O_CLOEXEC);
+            FILE* f = fd != -1 ? fdopen(fd, "wb") : nullptr;
+            if (fd != -1 && !f)
+                close(fd);
+        #endif
+
+        bool written = f && fwrite(content.data(), 1, content.size(), f) == content.size();
+        if (f && fclose(f) != 0)
+            written = false;
+        if (!written)
+        {
+            if (f)
+                remove(filename);
+            free(filename);
+            return nullptr;
+        }
+        return filename;
+    }
+
+    inline void DeleteResponseFile(char* const filename)
+    {
+        if (!filename)
+            return;
+
+        remove(filename);
+        free(filename);
+    }
+
     #ifdef _WIN32
         inline constexpr auto ToWinPath(const auto& path)
         {
-            static_assert(TypeTraits::IsStringLiteral<decltype(path)> || TypeTraits::IsString<decltype(path)>);
+            static_assert(TypeTraits::IsStringLiteral<decltype(path)> || TypeTraits::IsString<decltype(path)> || TypeTraits::IsSmallString<decltype(path)> || TypeTraits::IsPath<decltype(path)>);
 
             if constexpr (TypeTraits::IsString<decltype(path)>)
             {
                 String newPath = path;
-                for (size_t i = 0; i < SizeOf(newPath); i++)
-                    if (newPath[i] == '/')
-                        newPath[i] = '\\';
+                newPath.replace('/', '\\');
 
                 return newPath;
             }
             else
             {
-                const char* pPath = Helpers::ToCStr(path);
-                size_t pathLength = Helpers::StrLen(path);
-
-                String<4096> newPath;
-                strncpy(newPath.data(), pPath, pathLength);
-                size_t newPathLength = Length(newPath);
-                for (size_t i = 0; i < newPathLength; i++)
-                    if (newPath[i] == '/')
-                        newPath[i] = '\\';
+                SmallString newPath(Helpers::ToCStr(path));
+                newPath.replace('/', '\\');
 
                 return newPath;
             }
@@ -227,28 +659,19 @@ namespace TraumaBuildSystem::Helpers
 
         inline constexpr auto ToProperPath(const auto& path)
         {
-            static_assert(TypeTraits::IsStringLiteral<decltype(path)> || TypeTraits::IsString<decltype(path)>);
+            static_assert(TypeTraits::IsStringLiteral<decltype(path)> || TypeTraits::IsString<decltype(path)> || TypeTraits::IsSmallString<decltype(path)> || TypeTraits::IsPath<decltype(path)>);
 
             if constexpr (TypeTraits::IsString<decltype(path)>)
             {
                 String newPath = path;
-                for (size_t i = 0; i < SizeOf(newPath); i++)
-                    if (newPath[i] == '\\')
-                        newPath[i] = '/';
+                newPath.replace('\\', '/');
 
                 return newPath;
             }
             else
             {
-                const char* pPath = Helpers::ToCStr(path);
-                size_t pathLength = Helpers::StrLen(path);
-
-                String<4096> newPath;
-                strncpy(newPath.data(), pPath, pathLength);
-                size_t newPathLength = Length(newPath);
-                for (size_t i = 0; i < newPathLength; i++)
-                    if (newPath[i] == '\\')
-                        newPath[i] = '/';
+                SmallString newPath(Helpers::ToCStr(path));
+                newPath.replace('\\', '/');
 
                 return newPath;
             }
@@ -263,12 +686,135 @@ namespace TraumaBuildSystem::Helpers
             return wStr;
         }
 
-        inline String<4096> ToCStr(Windows::LPWSTR wStr)
+        // Turns any kind of command accepted by Call() into a single command line. For a CommandLine, arguments are quoted so that
+        // the program gets them back unchanged, and when the line would be too long they are moved to a response file, whose name
+        // is stored in responseFile: it must go through DeleteResponseFile() once the program exited.
+        inline void ToCommandString(const auto& cmd, Array<char>& commandString, char*& responseFile)
+        {
+            responseFile = nullptr;
+            if constexpr (TypeTraits::IsCommandLine<decltype(cmd)>)
+            {
+                cmd.join(commandString);
+                if (commandString.size() <= v1::Experimental::CommandLine::MaxLength || cmd.size() < 2)
+                    return;
+
+                commandString.clear();
+                responseFile = WriteResponseFile(cmd, 1);
+                v1::Experimental::CommandLine shortCmd(cmd[0]);
+                shortCmd.add("@", responseFile ? responseFile : "");
+                shortCmd.join(commandString);
+            }
+            else
+                commandString.append(ToCStr(cmd), Length(ToCStr(cmd)) + 1);
+        }
+
+        inline SmallString ToCStr(Windows::LPWSTR wStr)
         {
-            String<4096> string;
-            Windows::WideCharToMultiByte(CP_UTF8, 0, wStr, -1, string.data(), SizeOf(string), 0, 0);
+            SmallString string;
+            int stringLength = Windows::WideCharToMultiByte(CP_UTF8, 0, wStr, -1, nullptr, 0, 0, 0);
+            if (stringLength <= 1)
+                return string;
+
+            string.resize(static_cast<size_t>(stringLength - 1));
+            Windows::WideCharToMultiByte(CP_UTF8, 0, wStr, -1, string.data(), stringLength, 0, 0);
             return string;
         }
+    #elif defined(__linux__)
+        // Launches the program of cmd with posix_spawnp(), resolving it through PATH. If outputFd is valid, stdout and stderr are redirected to it.
+        // If responseFile is set, arguments too long for a command line are moved to a response file, whose name is stored there.
+        // Returns the child's pid, or -1 on failure.
+        inline pid_t SpawnProcess(const v1::Experimental::CommandLine& cmd, int outputFd = -1, char** responseFile = nullptr)
+        {
+            if (cmd.is_empty())
+                return -1;
+
+            // posix_spawnp() returns once the child called exec, which copies the arguments, so argv can point into cmd.
+            Array<char*> argv;
+            Array<char> responseArgument;
+            if (responseFile && cmd.length() > v1::Experimental::CommandLine::MaxLength && cmd.size() > 1)
+            {
+                *responseFile = WriteResponseFile(cmd, 1);
+                if (!*responseFile)
+                    return -1;
+
+                responseArgument.push('@');
+                responseArgument.append(*responseFile, Length(*responseFile) + 1);
+                argv.push(const_cast<char*>(cmd[0]));
+                argv.push(responseArgument.data());
+            }
+            else
+                for (size_t i = 0; i < cmd.size(); i++)
+                    argv.push(const_cast<char*>(cmd[i]));
+            argv.push(nullptr);
+
+            posix_spawn_file_actions_t actions;
+            posix_spawn_file_actions_init(&actions);
+            if (outputFd != -1)
+            {
+                posix_spawn_file_actions_adddup2(&actions, outputFd, STDOUT_FILENO);
+                posix_spawn_file_actions_adddup2(&actions, outputFd, STDERR_FILENO);
+            }
+
+            // The child starts in the calling thread's directory, and a relative program is looked up from there.
+            if (!gThreadContext.directory.is_empty())
+                posix_spawn_file_actions_addchdir_np(&actions, gThreadContext.directory);
+
+            // Variables the thread changed replace the process's ones, the others are passed along.
+            Array<char*> envp;
+            if (!gThreadContext.environment.is_empty())
+            {
+                auto NameLength = [] (const char* variable) { const char* end = strchr(variable, '='); return end ? static_cast<size_t>(end - variable) : strlen(variable); };
+                for (char** variable = environ; *variable; variable++)
+                {
+                    bool changed = false;
+                    for (const SmallString& change : gThreadContext.environment)
+                        changed = changed || (NameLength(change) == NameLength(*variable) && strncmp(change, *variable, NameLength(change)) == 0);
+                    if (!changed)
+                        envp.push(*variable);
+                }
+                for (const SmallString& change : gThreadContext.environment)
+                    if (strchr(change, '='))
+                        envp.push(const_cast<char*>(change.c_str()));
+                envp.push(nullptr);
+            }
+
+            pid_t pid = -1;
+            int error = posix_spawnp(&pid, argv[0], &actions, nullptr, argv.data(), envp.is_empty() ? environ : envp.data());
+            posix_spawn_file_actions_destroy(&actions);
+
+            // TODO: Detailed error reporting.
+            return error == 0 ? pid : -1;
+        }
+
+        // Splits cmd into arguments the way a shell would for a simple command, see CommandLine::add_split(), and launches it without one.
+        // Redirections, pipes and variables in cmd are passed to the program verbatim.
+        inline pid_t SpawnProcess(const char* const cmd, int outputFd = -1)
+        {
+            v1::Experimental::CommandLine args;
+            args.add_split(cmd);
+            return SpawnProcess(args, outputFd);
+        }
+
+        // Launches any kind of command accepted by Call(). Only a CommandLine can need a response file, which must go through DeleteResponseFile() once the child exited.
+        inline pid_t SpawnProcess(const auto& cmd, int outputFd, char*& responseFile)
+        {
+            responseFile = nullptr;
+            if constexpr (TypeTraits::IsCommandLine<decltype(cmd)>)
+                return SpawnProcess(cmd, outputFd, &responseFile);
+            else
+                return SpawnProcess(ToCStr(cmd), outputFd);
+        }
+
+        // Waits for the child to terminate. Returns its exit code, or -1 if it didn't exit normally.
+        inline int WaitProcess(pid_t pid)
+        {
+            int status = 0;
+            while (waitpid(pid, &status, 0) == -1)
+                if (errno != EINTR)
+                    return -1;
+
+            return WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+        }
     #endif
 }
 
@@ -278,547 +824,3978 @@ namespace TraumaBuildSystem::Platform
 {
     using VoidFnPtr = void(*)();
 
-    DynamicLibrary                  LoadLibrary(const char* const filename);
+    DynamicLibrary                  LoadLibrary(const auto& filename);
     void                            FreeLibrary(DynamicLibrary library);
 
     VoidFnPtr                       GetFunction(DynamicLibrary library, const char* const functionName);
 
     template <typename FunctionPointer>
     FunctionPointer                 GetFunction(DynamicLibrary library, const char* const functionName);
-}
 
+    using ThreadFnPtr = void(*)(void* data);
 
+    ThreadHandle                    StartThread(ThreadFnPtr fn, void* data);                            // Runs fn(data) on a new thread. Every started thread must be joined.
+    void                            JoinThread(ThreadHandle thread);                                    // Waits for thread to terminate and releases it.
+    size_t                          HardwareThreadCount();                                              // Returns the number of hardware threads available to this process. Never returns 0.
 
-constexpr auto TraumaBuildSystem::v1::Experimental::AsInclude(const auto& path)             { return Helpers::StrCat("-I", path); }
-constexpr auto TraumaBuildSystem::v1::Experimental::AsSystemInclude(const auto& path)       { return Helpers::StrCat("-isystem", path); }
-constexpr auto TraumaBuildSystem::v1::Experimental::AsLibrary(const auto& library)          { return Helpers::StrCat("-l", library); }
-constexpr auto TraumaBuildSystem::v1::Experimental::AsLibraryPath(const auto& path)         { return Helpers::StrCat("-L", path); }
-constexpr auto TraumaBuildSystem::v1::Experimental::AsDefine(const auto& name)              { return Helpers::StrCat("-D", name); }
+    // Mutexes and conditions are ready to use when zero initialized ( = {} ), and don't need to be destroyed.
+    void                            LockMutex(MutexHandle& mutex);
+    void                            UnlockMutex(MutexHandle& mutex);
+    void                            WaitCondition(ConditionHandle& condition, MutexHandle& mutex);      // mutex must be locked, it is released while waiting and locked again before returning.
+    void                            WakeAll(ConditionHandle& condition);
 
+    int                             RunProcess(const auto& cmd, const char* const outputFilename = nullptr); // Runs cmd and waits for it, returns its exit code or -1 on failure. If outputFilename is set, stdout and stderr are written to it.
+}
 
 
-inline constexpr auto TraumaBuildSystem::v1::Experimental::AsPath(const auto& path)
-{
-    String<4096> ret;
-    if (!IsValidPath(path))
-        return ret;
 
-    if (ContainsAnyOf(path, " "))
+namespace TraumaBuildSystem::v1::Experimental
+{
+    /*  Collects commands (jobs) and the dependencies between them, then runs them on a pool of worker threads.
+        Each worker owns a queue of ready jobs: it takes the most recent one from its own queue, and when that runs out
+        it steals the oldest one from the others. Jobs made ready by a finished job go to the queue of the worker that
+        ran it, so chains of dependent jobs tend to stay on the same worker.
+
+        When a job fails its dependents are skipped. Unless keepGoing is set, every job that didn't start yet is skipped too.
+    */
+    class Scheduler
     {
-        ret[0] = '\"';
-        ret.append(path);
-        ret.append("\"");
-    }
-    else
-        ret = path;
+        // ============================================================ Constructors / Destructors / Operators
 
-    #ifdef _WIN32
-        ret = Helpers::ToWinPath(ret);
-    #endif
+        public:
 
-    return ret;
-}
+        Scheduler() = default;
+        Scheduler(const Scheduler&) = delete;
+        Scheduler& operator=(const Scheduler&) = delete;
+        ~Scheduler();
 
+        // ============================================================ Functions
 
+        public:
 
-inline auto TraumaBuildSystem::v1::Experimental::AsAbsolutePath(const auto& path)
-{
-    String<4096> ret;
-    if (!IsValidPath(path))
-        return ret;
+        static constexpr int            SkippedExitCode                 = -2;                           // Exit code of jobs that didn't run because of a failure. -1 means the command couldn't be launched.
 
-    if (IsAbsolutePath(path))
-        return AsPath(path);
+        using JobFnPtr = void(*)(const CommandLine& arguments, int exitCode);
 
-    String cwd = CurrentWorkingDirectory();
+        JobId                           add(const auto& cmd, const char* const stampFile = nullptr, const char* const stampContent = nullptr);   // Queues cmd, a String or a CommandLine. An empty cmd always succeeds. If set, stampContent is written to stampFile when cmd succeeds.
+        void                            add_dependency(JobId job, JobId dependency);                    // job won't start until dependency succeeded.
+        void                            describe(JobId job, const char* const category, const auto& name); // What the build timeline shows for job, see EnableTrace(). category must be a string literal. By default jobs show their program.
+        void                            capture_output(JobId job, const auto& outputFile);              // Writes the output of job to outputFile, then prints it in one piece once job terminated, so that the output of parallel jobs never interleaves.
+        void                            on_exit(JobId job, JobFnPtr fn, const CommandLine& arguments);  // Calls fn(arguments, exitCode) on the worker that ran job, once it terminated. Skipped jobs don't call it.
+        bool                            run(size_t workerCount = 0, bool keepGoing = false);            // Runs all the queued jobs, workerCount 0 means one worker per hardware thread. Returns true if every job succeeded.
 
-    if (path[0] != '.')
-        return AsPath(cwd / path);
+        int                             exit_code(JobId job) const      { return mJobs[job].exitCode; }
+        size_t                          size() const                    { return mJobs.size(); }
 
-    const char* p = path;
-    p++;
-    uint16 levelsUp = 0;
-    while(*p == '.' || *p == '/')
-    {
-        if (*p == '/')
-            levelsUp++;
-        p++;
-    }
+        // ============================================================ Data
 
-    uint16 levelsDone = levelsUp;
-    size_t lastIndex = InvalidStringIndex;
-    while (levelsDone > 0)
-    {
-        size_t index = FindLastOf(cwd, "/", lastIndex - 1);
-        if (index == InvalidStringIndex || index == 0)
-            break;
-        lastIndex = index;
-        levelsDone--;
-    }
+        private:
 
-    ret.copy(cwd, 0, lastIndex);
-    ret.append("/");
-    ret.append(path, 3 * levelsUp);
+        struct Job
+        {
+            char*                       command;                        // nullptr when the job runs arguments.
+            CommandLine                 arguments;
+            char*                       stampFile;
+            char*                       stampContent;
+            const char*                 category;                       // Build timeline labels, name is nullptr until describe() is called.
+            char*                       name;
+            char*                       outputFile;
+            JobFnPtr                    onExit;
+            CommandLine                 onExitArguments;
+            Array<JobId>                dependents;
+            size_t                      dependencies;                   // Number of unfinished dependencies, while running.
+            bool                        dependencyFailed;
+            int                         exitCode;
+        };
 
-    return AsPath(ret);
+        Array<Job>                      mJobs;
+    };
 }
 
 
 
-inline constexpr auto TraumaBuildSystem::v1::Experimental::StripExtension(const auto& path)
+namespace TraumaBuildSystem::Helpers
 {
-    String<SizeOf(path)> ret;
-    if (!IsValidPath(path))
-        return ret;
+    struct ProcessData
+    {
+        #ifdef _WIN32
+            Windows::HANDLE             process;
+            Windows::HANDLE             outputPipe;
+            ThreadHandle                reader;                         // Drains outputPipe, blocking reads are the simplest way to consume anonymous pipes.
+        #elif defined(__linux__)
+            pid_t                       pid;
+            int                         pidFd;                          // Becomes readable when the process exits. -1 if the kernel doesn't support it.
+            int                         outputFd;                       // Closed (-1) once the output reached its end.
+            ProcessData*                next;
+        #endif
+
+        char*                           responseFile;                   // Deleted along with the Process.
+        char*                           output;
+        size_t                          outputSize;
+        size_t                          outputCapacity;
+        int                             exitCode;
+        bool                            exited;
+        bool                            waited;
+    };
+
+    void                            AppendOutput(ProcessData& data, const char* const buffer, size_t size);
+    bool                            IsFinished(ProcessData& data);
+    void                            WaitProcesses(ProcessData** processes, size_t count, bool block);   // Waits for at least one of processes to finish, or returns after a single poll if !block.
+
+    #ifdef __linux__
+        // Every Process whose output is being captured, or that wasn't reaped yet. An eventfd wakes up waiting threads when a new one is added.
+        struct ProcessRegistry
+        {
+            MutexHandle                 mutex                           = {};
+            ProcessData*                first                           = nullptr;
+            int                         wakeFd                          = -1;
+        };
 
-    size_t index = FindLastOf(path, ".");
-    if (index != InvalidStringIndex)
-        index--;
+        inline ProcessRegistry          gProcessRegistry;
 
-    ret.copy(path, 0, index);
-    return ret;
+        void                        PollProcesses(bool block);                                          // Drains pipes and reaps processes once. gProcessRegistry.mutex must be locked.
+    #endif
 }
 
 
 
-inline constexpr auto TraumaBuildSystem::v1::Experimental::StripFileName(const auto& path)
+namespace TraumaBuildSystem::v1::Experimental
 {
-    static_assert(TypeTraits::IsStringLiteral<decltype(path)> || TypeTraits::IsString<decltype(path)>);
-
-    String<sizeof(path)> ret;
-    if (!IsValidPath(path))
-        return ret;
+    // A handle to a process started by Spawn(). Destroying a Process waits for it to terminate.
+    class Process
+    {
+        // ============================================================ Constructors / Destructors / Operators
 
-    size_t index = FindLastOf(path, "\\/");
+        public:
 
-    if (index != InvalidStringIndex)
-        index--;
+        Process() = default;
+        explicit Process(Helpers::ProcessData* data)                    : mData(data) {}
+        Process(const Process&) = delete;
+        Process(Process&& other)                                        : mData(other.mData) { other.mData = nullptr; }
+        ~Process();
 
-    ret.copy(path, 0, index);
-    return ret;
-}
+        Process&                        operator=(const Process&) = delete;
+        Process&                        operator=(Process&& other);
 
+        // ============================================================ Functions
 
+        public:
 
-inline constexpr auto TraumaBuildSystem::v1::Experimental::StripPath(const auto& path)
-{
-    static_assert(TypeTraits::IsStringLiteral<decltype(path)> || TypeTraits::IsString<decltype(path)>);
+        bool                            is_valid() const                { return mData != nullptr; }
+        Helpers::ProcessData*           handle() const                  { return mData; }
 
-    String<sizeof(path)> ret;
-    if (!IsValidPath(path))
-        return ret;
+        // The captured output is complete only once the process has been waited on.
+        const char*                     output() const                  { return mData && mData->output ? mData->output : ""; }
+        size_t                          output_size() const             { return mData ? mData->outputSize : 0; }
 
-    size_t index = FindLastOf(path, "\\/");
+        // ============================================================ Data
 
-    if (index == InvalidStringIndex)
-        index = 0;
+        private:
 
-    ret.copy(path, 0, InvalidStringIndex, index);
-    return ret;
+        Helpers::ProcessData*           mData                           = nullptr;
+    };
 }
 
 
 
-inline constexpr auto TraumaBuildSystem::v1::Experimental::ExtensionOf(const auto& path)
+namespace TraumaBuildSystem::Helpers
 {
-    static_assert(TypeTraits::IsStringLiteral<decltype(path)> || TypeTraits::IsString<decltype(path)>);
+    // What Fingerprint() compares to trust a previous hash without reading the file again.
+    struct FileStamp
+    {
+        uint64                          size;
+        uint64                          time;                           // Same clock as LastModificationTime().
+        uint64                          inode;                          // Always 0 on Windows.
+    };
 
-    String<sizeof(path)> ret;
-    if (!IsValidPath(path))
-        return ret;
+    struct FingerprintEntry
+    {
+        uint64                          pathHash;                       // 0 marks an empty slot.
+        FileStamp                       stamp;
+        uint64                          fingerprint;
+    };
 
-    size_t index = FindLastOf(path, ".");
-    if (index == InvalidStringIndex)
-        return ret;
+    // Every fingerprint known to this module, shared by the threads of a batch.
+    struct FingerprintTable
+    {
+        MutexHandle                     mutex                           = {};
+        Array<FingerprintEntry>         entries;
+        size_t                          count                           = 0;
+    };
 
-    ret.copy(path, 0, InvalidStringIndex, index + 1);
-    return ret;
-}
+    inline FingerprintTable             gFingerprints;
+    inline constexpr char               FingerprintsMagic[8]            = { 'T', 'B', 'S', 'F', 'P', 'R', 'T', '1' };
 
+    struct FileSystemEntry
+    {
+        uint64                          pathHash;                       // 0 marks an empty slot.
+        FileStamp                       stamp;
+        bool                            exists;
+        bool                            known;                          // Invalidated entries stay in the table, so that the slots after them can still be found.
+    };
 
+    struct DirectoryListing
+    {
+        uint64                          pathHash;                       // 0 marks an empty slot.
+        char*                           names;                          // Null terminated entry names, one after the other.
+        size_t                          size;
+        bool                            known;
+    };
 
-inline bool TraumaBuildSystem::v1::Experimental::Exists(const auto& path)
-{
-    static_assert(TypeTraits::IsStringLiteral<decltype(path)> || TypeTraits::IsString<decltype(path)>);
+    // Paths are keyed by the hash of their normalized absolute form, so that every spelling of a path shares the same entry.
+    struct FileSystemCache
+    {
+        MutexHandle                     mutex                           = {};
+        bool                            enabled                         = false;
+        SmallString                     workingDirectory;
+        Array<FileSystemEntry>          entries;
+        size_t                          entryCount                      = 0;
+        Array<DirectoryListing>         listings;
+        size_t                          listingCount                    = 0;
+    };
 
-    #ifdef _WIN32
-        auto winPath = Helpers::ToWinPath(path);
-        Windows::LPWSTR wStr = Helpers::ToWStr(winPath);
-        Windows::BOOL result = Windows::PathFileExistsW(wStr);
-        free(wStr);
-        return result;
-    #endif
-}
+    inline FileSystemCache              gFileSystemCache;
 
+    // Open addressing tables of entries keyed by their pathHash. The size of a table is a power of two, and it's kept at most half full.
+    template <typename Entry>
+    Entry*                          FindEntry(Array<Entry>& table, uint64 pathHash);                    // Returns the entry of pathHash, or the empty slot where it belongs. nullptr if table is empty.
+    template <typename Entry>
+    void                            StoreEntry(Array<Entry>& table, size_t& count, const Entry& entry);
 
+    bool                            GetFileStamp(const char* const filename, FileStamp& stamp);        // Returns false if filename doesn't exist.
+    bool                            QueryFileStamp(const char* const filename, FileStamp& stamp);      // Like GetFileStamp(), going through gFileSystemCache when it's enabled.
+    uint64                          CurrentFileTime();                                                  // Returns the current time, on the same clock as FileStamp::time.
 
-inline bool TraumaBuildSystem::v1::Experimental::NotExists(const auto& path)
-{
-    return !Exists(path);
-}
+    size_t                          NormalizePath(const char* const path, char (&normalized)[4096]);   // Writes path made absolute, without '.' and repeated separators, and returns its length. Returns 0 if path can't be cached. gFileSystemCache.mutex must be locked.
+    void                            InvalidatePath(const char* const path);                             // Forgets what gFileSystemCache knows about path and about the content of its parent directory.
 
+    #ifdef __linux__
+        void                        ListDirectory(const char* const directory, Array<char>& names);     // Appends the names in directory, '.' and '..' excluded, as consecutive null terminated strings. Goes through gFileSystemCache when it's enabled.
+        bool                        DeleteTree(int parentFd, const char* const path);                   // Deletes path, relative to parentFd, and all its content. Subdirectories are spread over several threads, symlinks are removed rather than followed.
+    #endif
 
+    bool                            ListTree(const char* const directory, Array<SmallString>& files, Array<SmallString>& directories); // Appends the paths under directory, relative to it, each directory before its content. Symlinks to files count as files, symlinks to directories are skipped. Returns false if directory can't be listed.
+    bool                            SetModificationTime(const char* const filename, uint64 time);      // time is on the same clock as FileStamp::time. Returns true on success.
+    SmallString                     TrashPath(const char* const path);                                  // Returns a unique hidden sibling of path, its trailing separators ignored, for DeleteDirectoryAsync() to move it to.
 
-inline constexpr bool TraumaBuildSystem::v1::Experimental::IsValidPath([[maybe_unused]] const auto& path)
-{
+    // Events recorded for the build timeline, already formatted as trace-event JSON objects, each one followed by a comma.
+    struct TraceLog
+    {
+        MutexHandle                     mutex                           = {};
+        Array<char>                     events;
+        uint64                          startTime                       = 0;                            // Timestamps are relative to this, MonotonicTime() when recording started.
+        size_t                          slotCount                       = 0;                            // Highest slot used so far, plus one.
+    };
+
+    inline TraceLog                     gTraceLog;
+    inline TraceLog*                    gTrace                          = nullptr;                      // Where events go, nullptr while recording is off. Script modules get the runner's one through AttachTrace().
+    inline thread_local size_t          gTraceSlot                      = 0;                            // Job slot of the calling thread: the worker index inside a Scheduler or the runner, 0 anywhere else.
+
+    uint64                          MonotonicTime();                                                    // Returns a time in nanoseconds, only meaningful when compared to other values returned by this function.
+    void                            TraceCommand(const auto& cmd, Array<char>& command, Array<char>& name); // Writes cmd as a null terminated line, and its program as the event name.
+    void                            RecordTrace(const char* const category, const char* const name, const char* const command, uint64 startTime, int exitCode); // Records an event on gTraceSlot that started at startTime and ends now.
+
+    // What the build steps of a script read, so that the runner's watch mode knows which changes affect it. Compiled steps are recorded through
+    // their dependency file, which the compiler rewrites with the sources and headers of every compile, the steps that always run through their inputs.
+    struct DependencyLog
+    {
+        MutexHandle                     mutex                           = {};
+        Array<SmallString>              dependencyFiles;
+        Array<SmallString>              inputs;
+    };
+
+    inline DependencyLog*               gDependencies                   = nullptr;                      // Where steps are recorded, nullptr outside of the runner. Script modules get the runner's one through AttachDependencyLog().
+
+    void                            RecordDependencies(const char* const dependencyFile, const char* const input); // Appends either argument to gDependencies unless it's nullptr.
+
+    /*  Like ccache's direct mode: the base key of an object covers the compiler's identity, the command line and the source, and names a manifest,
+        the dependency file written by the last compile with that base key. The object's key adds the content of every file the manifest lists,
+        so it only matches while the headers that the last compile included are unchanged. Entries are written to a temporary file first,
+        then renamed, so that concurrent builds never see a partial one.
+    */
+    struct ObjectCache
+    {
+        bool                            enabled                         = false;
+        SmallString                     directory;
+        uint64                          compilerKey                     = 0;                            // Hash of the compiler's --version.
+    };
+
+    inline ObjectCache                  gObjectCache;
+
+    SmallString                     ObjectCachePath(uint64 key, const char* const extension);           // Entries are spread over 256 subdirectories, named after the first byte of their key.
+    bool                            ObjectKey(uint64 baseKey, const char* const dependencies, uint64& key); // Computes the key of an object from the content of its dependencies. Returns false if one of them is missing.
+    bool                            RestoreObject(uint64 baseKey, const char* const object, const char* const dependencyFile, const char* const outputFile); // Copies a cached object and its dependency file in place, and its diagnostics to outputFile. Returns false on a miss.
+    void                            StoreObject(const v1::Experimental::CommandLine& arguments, int exitCode); // Scheduler::on_exit() function of a compile job, arguments are the base key, the dependency file, the object and the output file.
+    bool                            StoreCacheFile(const char* const filename, const char* const cacheFilename); // Copies filename into the cache atomically. Returns true on success.
+
+    // Queues the compilation of sourceFile like Compile() does, writing objectBase.o, and its .d, .cmd and .log files next to it. queued is set when the job has work to do.
+    v1::Experimental::JobId         CompileObject(v1::Experimental::Scheduler& scheduler, const auto& sourceFile, const auto& objectBase, const auto& compilerFlags, const auto& includes, bool& queued);
+}
+
+
+
+constexpr auto TraumaBuildSystem::v1::Experimental::AsInclude(const auto& path)             { return Helpers::StrCat("-I", path); }
+constexpr auto TraumaBuildSystem::v1::Experimental::AsSystemInclude(const auto& path)       { return Helpers::StrCat("-isystem", path); }
+constexpr auto TraumaBuildSystem::v1::Experimental::AsLibrary(const auto& library)          { return Helpers::StrCat("-l", library); }
+constexpr auto TraumaBuildSystem::v1::Experimental::AsLibraryPath(const auto& path)         { return Helpers::StrCat("-L", path); }
+constexpr auto TraumaBuildSystem::v1::Experimental::AsDefine(const auto& name)              { return Helpers::StrCat("-D", name); }
+
+
+
+inline constexpr auto TraumaBuildSystem::v1::Experimental::AsPath(const auto& path)
+{
+    auto Quote = [&] (auto ret)
+    {
+        if (!IsValidPath(path))
+            return ret;
+
+        if (ContainsAnyOf(Helpers::ToCStr(path), " "))
+        {
+            ret = "\"";
+            ret.append(Helpers::ToCStr(path));
+            ret.append("\"");
+        }
+        else
+            ret = Helpers::ToCStr(path);
+
+        #ifdef _WIN32
+            ret.replace('/', '\\');
+        #endif
+
+        return ret;
+    };
+
+    // Sizes known at compile time keep the result constexpr, with room for the quotes.
+    if constexpr (TypeTraits::IsString<decltype(path)> || TypeTraits::IsSizedStringLiteral<decltype(path)>)
+        return Quote(String<sizeof(path) + 2>());
+    else
+        return Quote(SmallString());
+}
+
+
+
+inline auto TraumaBuildSystem::v1::Experimental::AsAbsolutePath(const auto& path)
+{
+    SmallString ret;
+    if (!IsValidPath(path))
+        return ret;
+
+    if (IsAbsolutePath(path))
+        return AsPath(SmallString(Helpers::ToCStr(path)));
+
+    if constexpr (TypeTraits::IsPath<decltype(path)>)
+        return AsPath(SmallString((Path(CurrentWorkingDirectory()) / path).c_str()));
+    else
+    {
+        SmallString cwd = CurrentWorkingDirectory();
+
+        if (path[0] != '.')
+            return AsPath(cwd / Helpers::ToCStr(path));
+
+        const char* p = path;
+        p++;
+        uint16 levelsUp = 0;
+        while(*p == '.' || *p == '/')
+        {
+            if (*p == '/')
+                levelsUp++;
+            p++;
+        }
+
+        uint16 levelsDone = levelsUp;
+        size_t lastIndex = InvalidStringIndex;
+        while (levelsDone > 0)
+        {
+            size_t index = FindLastOf(cwd, "/", lastIndex - 1);
+            if (index == InvalidStringIndex || index == 0)
+                break;
+            lastIndex = index;
+            levelsDone--;
+        }
+
+        ret.append(cwd, lastIndex < cwd.length() ? lastIndex : cwd.length());
+        ret.append("/");
+        ret.append(Helpers::ToCStr(path) + 3 * levelsUp);
+
+        return AsPath(ret);
+    }
+}
+
+
+
+inline constexpr auto TraumaBuildSystem::v1::Experimental::StripExtension(const auto& path)
+{
+    if constexpr (TypeTraits::IsPath<decltype(path)>)
+    {
+        Path ret(path);
+        if (const char* extension = ret.extension(); *extension != '\0')
+            ret.data()[extension - ret.c_str() - 1] = '\0';
+        return Path(ret.c_str());
+    }
+    else if constexpr (TypeTraits::IsSmallString<decltype(path)>)
+    {
+        size_t index = FindLastOf(path.c_str(), ".");
+        return SmallString(path.c_str(), index != InvalidStringIndex ? index : path.length());
+    }
+    else
+    {
+        String<sizeof(path)> ret;
+        if (!IsValidPath(path))
+            return ret;
+
+        ret.copy(path, 0, FindLastOf(path, "."));
+        return ret;
+    }
+}
+
+
+
+inline constexpr auto TraumaBuildSystem::v1::Experimental::StripFileName(const auto& path)
+{
+    static_assert(TypeTraits::IsStringLiteral<decltype(path)> || TypeTraits::IsString<decltype(path)> || TypeTraits::IsSmallString<decltype(path)> || TypeTraits::IsPath<decltype(path)>);
+
+    if constexpr (TypeTraits::IsPath<decltype(path)>)
+        return path.parent();
+    else if constexpr (TypeTraits::IsSmallString<decltype(path)>)
+    {
+        size_t index = FindLastOf(path.c_str(), "\\/");
+        return SmallString(path.c_str(), index != InvalidStringIndex ? index : 0);
+    }
+    else
+    {
+        String<sizeof(path)> ret;
+        if (!IsValidPath(path))
+            return ret;
+
+        size_t index = FindLastOf(path, "\\/");
+        if (index != InvalidStringIndex)
+            ret.copy(path, 0, index);
+        return ret;
+    }
+}
+
+
+
+inline constexpr auto TraumaBuildSystem::v1::Experimental::StripPath(const auto& path)
+{
+    static_assert(TypeTraits::IsStringLiteral<decltype(path)> || TypeTraits::IsString<decltype(path)> || TypeTraits::IsSmallString<decltype(path)> || TypeTraits::IsPath<decltype(path)>);
+
+    if constexpr (TypeTraits::IsPath<decltype(path)>)
+        return Path(path.file_name());
+    else if constexpr (TypeTraits::IsSmallString<decltype(path)>)
+    {
+        size_t index = FindLastOf(path.c_str(), "\\/");
+        return SmallString(path.c_str() + (index != InvalidStringIndex ? index + 1 : 0));
+    }
+    else
+    {
+        String<sizeof(path)> ret;
+        if (!IsValidPath(path))
+            return ret;
+
+        size_t index = FindLastOf(path, "\\/");
+        ret.copy(path, 0, InvalidStringIndex, index != InvalidStringIndex ? index + 1 : 0);
+        return ret;
+    }
+}
+
+
+
+inline constexpr auto TraumaBuildSystem::v1::Experimental::ExtensionOf(const auto& path)
+{
+    static_assert(TypeTraits::IsStringLiteral<decltype(path)> || TypeTraits::IsString<decltype(path)> || TypeTraits::IsSmallString<decltype(path)> || TypeTraits::IsPath<decltype(path)>);
+
+    if constexpr (TypeTraits::IsPath<decltype(path)>)
+        return Path(path.extension());
+    else if constexpr (TypeTraits::IsSmallString<decltype(path)>)
+    {
+        size_t index = FindLastOf(path.c_str(), ".");
+        return SmallString(index != InvalidStringIndex ? path.c_str() + index + 1 : "");
+    }
+    else
+    {
+        String<sizeof(path)> ret;
+        if (!IsValidPath(path))
+            return ret;
+
+        size_t index = FindLastOf(path, ".");
+        if (index == InvalidStringIndex)
+            return ret;
+
+        ret.copy(path, 0, InvalidStringIndex, index + 1);
+        return ret;
+    }
+}
+
+
+
+inline bool TraumaBuildSystem::v1::Experimental::Exists(const auto& path)
+{
+    static_assert(TypeTraits::IsStringLiteral<decltype(path)> || TypeTraits::IsString<decltype(path)> || TypeTraits::IsSmallString<decltype(path)> || TypeTraits::IsPath<decltype(path)>);
+
+    if (Helpers::gFileSystemCache.enabled)
+    {
+        Helpers::FileStamp stamp;
+        return Helpers::QueryFileStamp(Helpers::ToCStr(path), stamp);
+    }
+
+    #ifdef _WIN32
+        auto winPath = Helpers::ToWinPath(Helpers::ToThreadPath(Helpers::ToCStr(path)));
+        Windows::LPWSTR wStr = Helpers::ToWStr(winPath);
+        Windows::BOOL result = Windows::PathFileExistsW(wStr);
+        free(wStr);
+        return result;
+    #elif defined(__linux__)
+        struct stat fileStat;
+        return fstatat(Helpers::gThreadContext.directoryFd, Helpers::ToCStr(path), &fileStat, 0) == 0;
+    #endif
+}
+
+
+
+inline bool TraumaBuildSystem::v1::Experimental::NotExists(const auto& path)
+{
+    return !Exists(path);
+}
+
+
+
+inline uint64 TraumaBuildSystem::v1::Experimental::LastModificationTime(const auto& path)
+{
+    static_assert(TypeTraits::IsStringLiteral<decltype(path)> || TypeTraits::IsString<decltype(path)> || TypeTraits::IsSmallString<decltype(path)> || TypeTraits::IsPath<decltype(path)>);
+
+    if (Helpers::gFileSystemCache.enabled)
+    {
+        Helpers::FileStamp stamp;
+        return Helpers::QueryFileStamp(Helpers::ToCStr(path), stamp) ? stamp.time : 0;
+    }
+
+    #ifdef _WIN32
+        // 100ns intervals since January 1, 1601.
+        auto wStr = Helpers::ToWStr(Helpers::ToWinPath(Helpers::ToThreadPath(Helpers::ToCStr(path))));
+        Windows::WIN32_FILE_ATTRIBUTE_DATA fileData = {};
+        bool success = Windows::GetFileAttributesExW(wStr, Windows::GetFileExInfoStandard, &fileData);
+        free(wStr);
+        return success ? (static_cast<uint64>(fileData.ftLastWriteTime.dwHighDateTime) << 32) | fileData.ftLastWriteTime.dwLowDateTime : 0;
+    #elif defined(__linux__)
+        // Nanoseconds since the Unix epoch.
+        struct stat fileStat;
+        if (fstatat(Helpers::gThreadContext.directoryFd, Helpers::ToCStr(path), &fileStat, 0) != 0)
+            return 0;
+        return static_cast<uint64>(fileStat.st_mtim.tv_sec) * 1000000000ull + static_cast<uint64>(fileStat.st_mtim.tv_nsec);
+    #endif
+}
+
+
+
+inline constexpr bool TraumaBuildSystem::v1::Experimental::IsValidPath([[maybe_unused]] const auto& path)
+{
+    // TODO
+    return true;
+}
+
+
+
+inline constexpr bool TraumaBuildSystem::v1::Experimental::IsAbsolutePath([[maybe_unused]] const auto& path)
+{
+    // TODO
+    return false;
+}
+
+
+
+inline constexpr bool TraumaBuildSystem::v1::Experimental::IsRelativePath([[maybe_unused]] const auto& path)
+{
     // TODO
+    return false;
+}
+
+
+
+inline bool TraumaBuildSystem::v1::Experimental::CreateDirectory(const auto& path)
+{
+    static_assert(TypeTraits::IsStringLiteral<decltype(path)> || TypeTraits::IsString<decltype(path)> || TypeTraits::IsSmallString<decltype(path)> || TypeTraits::IsPath<decltype(path)>);
+    if (!IsValidPath(path)) return false;
+
+    // Create the intermediates in place, temporarily terminating the path after each component.
+    Path directory(Helpers::ToCStr(path));
+    if (directory.component_count() == 0)
+        return false;
+
+    #ifdef _WIN32
+        // Separators are kept as '/' so that component offsets still match in the wide string, CreateDirectoryW() accepts both.
+        auto wStr = Helpers::ToWStr(Helpers::ToThreadPath(directory));
+        size_t wStrLength = wcslen(wStr);
+        for (size_t i = 1; i < wStrLength; i++)
+        {
+            if (wStr[i] != L'/')
+                continue;
+
+            wStr[i] = L'\0';
+            Windows::CreateDirectoryW(wStr, nullptr);
+            wStr[i] = L'/';
+        }
+
+        // TODO: Detailed error reporting.
+        bool success = Windows::CreateDirectoryW(wStr, nullptr);
+        free(wStr);
+    #elif defined(__linux__)
+        for (size_t i = 1; i < directory.component_count(); i++)
+        {
+            size_t separator = directory.component_offset(i) - 1;
+            directory.data()[separator] = '\0';
+            if (mkdirat(Helpers::gThreadContext.directoryFd, directory, 0777) == 0)
+                Helpers::InvalidatePath(directory);
+            directory.data()[separator] = '/';
+        }
+
+        // TODO: Detailed error reporting.
+        bool success = mkdirat(Helpers::gThreadContext.directoryFd, directory, 0777) == 0;
+    #endif
+
+    Helpers::InvalidatePath(directory);
+    return success;
+}
+
+
+
+inline bool TraumaBuildSystem::v1::Experimental::DeleteDirectory(const auto& path)
+{
+    static_assert(TypeTraits::IsStringLiteral<decltype(path)> || TypeTraits::IsString<decltype(path)> || TypeTraits::IsSmallString<decltype(path)> || TypeTraits::IsPath<decltype(path)>);
+
+    #ifdef _WIN32
+        // The list of paths given to SHFileOperationW() ends with an empty one.
+        auto winPath = Helpers::ToWinPath(Helpers::ToThreadPath(Helpers::ToCStr(path)));
+        winPath.push('\0');
+        auto wStr = Helpers::ToWStr(winPath);
+        Windows::SHFILEOPSTRUCTW op = {};
+        op.wFunc = FO_DELETE;
+        op.pFrom = wStr;
+        op.fFlags = FOF_NOCONFIRMATION | FOF_NOERRORUI | FOF_SILENT;
+        Windows::SHFileOperationW(&op);
+        free(wStr);
+        InvalidateFileSystemCache();
+        return !op.fAnyOperationsAborted;
+    #elif defined(__linux__)
+        bool success = Helpers::DeleteTree(Helpers::gThreadContext.directoryFd, Helpers::ToCStr(path));
+        InvalidateFileSystemCache();
+        return success;
+    #endif
+}
+
+
+
+inline bool TraumaBuildSystem::v1::Experimental::DeleteDirectoryAsync(const auto& path)
+{
+    static_assert(TypeTraits::IsStringLiteral<decltype(path)> || TypeTraits::IsString<decltype(path)> || TypeTraits::IsSmallString<decltype(path)> || TypeTraits::IsPath<decltype(path)>);
+
+    // A rename within the parent directory is atomic and doesn't depend on the size of the tree, so path can be recreated right away.
+    // The content is deleted by a process rather than a thread, which would run code from a script module the runner may unload before it's done.
+    SmallString trash = Helpers::TrashPath(Helpers::ToCStr(path));
+    #ifdef _WIN32
+        auto wStrPath = Helpers::ToWStr(Helpers::ToWinPath(Helpers::ToThreadPath(Helpers::ToCStr(path))));
+        auto wStrTrash = Helpers::ToWStr(Helpers::ToWinPath(Helpers::ToThreadPath(trash)));
+        bool moved = Windows::MoveFileExW(wStrPath, wStrTrash, 0);
+        free(wStrPath);
+        free(wStrTrash);
+        if (!moved)
+            return DeleteDirectory(path);
+
+        SmallString command("cmd /c rd /s /q \"");
+        command.append(Helpers::ToWinPath(Helpers::ToThreadPath(trash)));
+        command.append("\"");
+        auto wStrCmd = Helpers::ToWStr(command);
+        Windows::STARTUPINFOW startupInfo = {};
+        startupInfo.cb = sizeof(startupInfo);
+        Windows::PROCESS_INFORMATION processInfo = {};
+        bool started = Windows::CreateProcessW(nullptr, wStrCmd, nullptr, nullptr, FALSE, CREATE_NO_WINDOW, nullptr, nullptr, &startupInfo, &processInfo);
+        free(wStrCmd);
+        if (started)
+        {
+            Windows::CloseHandle(processInfo.hThread);
+            Windows::CloseHandle(processInfo.hProcess);
+        }
+        else
+            DeleteDirectory(trash);
+    #elif defined(__linux__)
+        // Directories that can't be renamed, like mount points, are deleted in place.
+        if (renameat(Helpers::gThreadContext.directoryFd, Helpers::ToCStr(path), Helpers::gThreadContext.directoryFd, trash) != 0)
+            return DeleteDirectory(path);
+
+        // The shell puts rm in the background and exits at once, so the only child to wait for is the shell, and rm outlives this process if needed.
+        CommandLine cmd("sh");
+        cmd.add("-c").add("rm -rf -- \"$0\" &").add(trash);
+        if (pid_t pid = Helpers::SpawnProcess(cmd); pid == -1 || Helpers::WaitProcess(pid) != 0)
+            Helpers::DeleteTree(Helpers::gThreadContext.directoryFd, trash);
+    #endif
+
+    InvalidateFileSystemCache();
     return true;
 }
 
 
 
-inline constexpr bool TraumaBuildSystem::v1::Experimental::IsAbsolutePath([[maybe_unused]] const auto& path)
+inline bool TraumaBuildSystem::v1::Experimental::CopyDirectory(const auto& fromPath, const auto& toPath)
+{
+    static_assert(TypeTraits::IsStringLiteral<decltype(fromPath)> || TypeTraits::IsString<decltype(fromPath)> || TypeTraits::IsSmallString<decltype(fromPath)> || TypeTraits::IsPath<decltype(fromPath)>);
+    static_assert(TypeTraits::IsStringLiteral<decltype(toPath)> || TypeTraits::IsString<decltype(toPath)> || TypeTraits::IsSmallString<decltype(toPath)> || TypeTraits::IsPath<decltype(toPath)>);
+
+    if (!IsValidPath(fromPath) || !IsValidPath(toPath)) return false;
+
+    struct Batch
+    {
+        SmallString                     from;
+        SmallString                     to;
+        Array<SmallString>              files;
+        size_t                          next                            = 0;
+        bool                            success                         = true;
+    };
+
+    Batch batch = { SmallString(Helpers::ToCStr(fromPath)), SmallString(Helpers::ToCStr(toPath)) };
+    Array<SmallString> directories;
+    if (!Helpers::ListTree(batch.from, batch.files, directories))
+        return false;
+
+    // Parents are listed before their subdirectories, so each one only creates itself.
+    bool success = CreateDirectory(batch.to) || Exists(batch.to);
+    for (const SmallString& directory : directories)
+        success = (CreateDirectory(batch.to / directory) || Exists(batch.to / directory)) && success;
+
+    // Copies get the modification time of their source, so that they are skipped on the next run without being read.
+    // Identical files with different times are hashed once, then get the time too.
+    auto Work = [] (void* batchPtr)
+    {
+        auto& batch = *static_cast<Batch*>(batchPtr);
+        for (size_t i = __atomic_fetch_add(&batch.next, 1, __ATOMIC_RELAXED); i < batch.files.size(); i = __atomic_fetch_add(&batch.next, 1, __ATOMIC_RELAXED))
+        {
+            SmallString from = batch.from / batch.files[i];
+            SmallString to = batch.to / batch.files[i];
+            Helpers::FileStamp fromStamp = {};
+            Helpers::FileStamp toStamp = {};
+            bool copied = Helpers::GetFileStamp(from, fromStamp);
+            bool exists = copied && Helpers::GetFileStamp(to, toStamp);
+            if (exists && toStamp.size == fromStamp.size && toStamp.time == fromStamp.time)
+                continue;
+
+            bool same = exists && toStamp.size == fromStamp.size && Fingerprint(from) == Fingerprint(to);
+            copied = copied && (same || CopyFile(from, to)) && Helpers::SetModificationTime(to, fromStamp.time);
+            if (!copied)
+                __atomic_store_n(&batch.success, false, __ATOMIC_RELAXED);
+        }
+    };
+
+    // Copies mostly wait on the disks, which keep up with more requests in flight than there are cores.
+    size_t workerCount = Platform::HardwareThreadCount() < 4 ? 4 : Platform::HardwareThreadCount();
+    if (workerCount > batch.files.size())
+        workerCount = batch.files.size();
+
+    // The calling thread is a worker too.
+    Array<ThreadHandle> threads;
+    for (size_t i = 1; i < workerCount; i++)
+        threads.push(Platform::StartThread(Work, &batch));
+    Work(&batch);
+    for (ThreadHandle thread : threads)
+        Platform::JoinThread(thread);
+
+    return success && batch.success;
+}
+
+
+
+inline auto TraumaBuildSystem::v1::Experimental::CurrentWorkingDirectory()
+{
+    if (!Helpers::gThreadContext.directory.is_empty())
+        return Helpers::gThreadContext.directory;
+
+    #ifdef _WIN32
+        Windows::DWORD wStrBufferCharLength = Windows::GetCurrentDirectoryW(0, nullptr);
+        auto wStr = static_cast<Windows::LPWSTR>(malloc(static_cast<size_t>(wStrBufferCharLength) * sizeof(wchar_t)));
+        Windows::GetCurrentDirectoryW(wStrBufferCharLength, wStr);
+        SmallString currentDir = Helpers::ToCStr(wStr);
+        free(wStr);
+        currentDir.replace('\\', '/');
+        return currentDir;
+    #elif defined(__linux__)
+        // The buffer grows until the path fits, paths longer than 64 KB are reported as empty.
+        SmallString currentDir;
+        for (size_t capacity = 256; capacity <= 64 * 1024; capacity *= 2)
+        {
+            currentDir.reserve(capacity);
+            if (getcwd(currentDir.data(), capacity + 1))
+            {
+                currentDir.resize(strlen(currentDir.data()));
+                break;
+            }
+            if (errno != ERANGE)
+                break;
+        }
+        return currentDir;
+    #endif
+}
+
+
+
+inline bool TraumaBuildSystem::v1::Experimental::CurrentWorkingDirectory(const auto& path)
+{
+    static_assert(TypeTraits::IsStringLiteral<decltype(path)> || TypeTraits::IsString<decltype(path)> || TypeTraits::IsSmallString<decltype(path)> || TypeTraits::IsPath<decltype(path)>);
+
+    #ifdef _WIN32
+        Windows::LPWSTR wStr = Helpers::ToWStr(Helpers::ToWinPath(path));
+        bool success = Windows::SetCurrentDirectoryW(wStr);
+        free(wStr);
+    #elif defined(__linux__)
+        bool success = chdir(Helpers::ToCStr(path)) == 0;
+    #endif
+
+    // Cached paths are absolute, only relative ones have to be resolved differently from now on.
+    if (success && Helpers::gFileSystemCache.enabled)
+    {
+        Platform::LockMutex(Helpers::gFileSystemCache.mutex);
+        Helpers::gFileSystemCache.workingDirectory = CurrentWorkingDirectory();
+        Platform::UnlockMutex(Helpers::gFileSystemCache.mutex);
+    }
+    return success;
+}
+
+
+
+inline bool TraumaBuildSystem::v1::Experimental::SetThreadDirectory(const auto& path)
+{
+    static_assert(TypeTraits::IsStringLiteral<decltype(path)> || TypeTraits::IsString<decltype(path)> || TypeTraits::IsSmallString<decltype(path)> || TypeTraits::IsPath<decltype(path)>);
+
+    Helpers::ThreadContext& context = Helpers::gThreadContext;
+    #ifdef _WIN32
+        Windows::LPWSTR wStr = Helpers::ToWStr(Helpers::ToWinPath(Helpers::ToThreadPath(Helpers::ToCStr(path))));
+        Windows::DWORD wStrBufferCharLength = Windows::GetFullPathNameW(wStr, 0, nullptr, nullptr);
+        auto wFullPath = static_cast<Windows::LPWSTR>(malloc(static_cast<size_t>(wStrBufferCharLength) * sizeof(wchar_t)));
+        Windows::GetFullPathNameW(wStr, wStrBufferCharLength, wFullPath, nullptr);
+        Windows::DWORD attributes = Windows::GetFileAttributesW(wFullPath);
+        SmallString directory = Helpers::ToCStr(wFullPath);
+        free(wStr);
+        free(wFullPath);
+        if (attributes == INVALID_FILE_ATTRIBUTES || !(attributes & FILE_ATTRIBUTE_DIRECTORY))
+            return false;
+
+        directory.replace('\\', '/');
+        context.directory = static_cast<SmallString&&>(directory);
+    #elif defined(__linux__)
+        int directoryFd = openat(context.directoryFd, Helpers::ToCStr(path), O_PATH | O_DIRECTORY | O_CLOEXEC);
+        if (directoryFd == -1)
+            return false;
+
+        // The path the descriptor was opened with may have gone through symbolic links, the kernel knows the real one.
+        char link[32];
+        snprintf(link, sizeof(link), "/proc/self/fd/%d", directoryFd);
+        SmallString directory;
+        directory.reserve(4096);
+        ssize_t length = readlink(link, directory.data(), 4096);
+        if (length <= 0 || length >= 4096 || directory[0] != '/')
+        {
+            close(directoryFd);
+            return false;
+        }
+        directory.resize(static_cast<size_t>(length));
+
+        if (context.directoryFd != AT_FDCWD)
+            close(context.directoryFd);
+        context.directoryFd = directoryFd;
+        context.directory = static_cast<SmallString&&>(directory);
+    #endif
+
+    return true;
+}
+
+
+
+inline void TraumaBuildSystem::v1::Experimental::ResetThreadDirectory()
+{
+    Helpers::ThreadContext& context = Helpers::gThreadContext;
+    #ifdef __linux__
+        if (context.directoryFd != AT_FDCWD)
+            close(context.directoryFd);
+        context.directoryFd = AT_FDCWD;
+    #endif
+    context.directory.clear();
+}
+
+
+
+inline void TraumaBuildSystem::v1::Experimental::SetThreadEnvironment(const char* const name, const char* const value)
+{
+    assert(name && *name != '\0' && !strchr(name, '='));
+
+    // Only the latest change to a variable is kept.
+    Array<SmallString>& environment = Helpers::gThreadContext.environment;
+    size_t nameLength = strlen(name);
+    for (size_t i = 0; i < environment.size(); i++)
+        if (strncmp(environment[i], name, nameLength) == 0 && (environment[i][nameLength] == '=' || environment[i][nameLength] == '\0'))
+        {
+            environment[i] = static_cast<SmallString&&>(environment.back());
+            environment.pop();
+            break;
+        }
+
+    SmallString change(name);
+    if (value)
+    {
+        change.push('=');
+        change.append(value);
+    }
+    environment.push(static_cast<SmallString&&>(change));
+}
+
+
+
+inline void TraumaBuildSystem::v1::Experimental::ResetThreadEnvironment()
+{
+    Helpers::gThreadContext.environment.clear();
+}
+
+
+
+inline void TraumaBuildSystem::v1::Experimental::ForEachFile(const auto& path, auto&& fn)
+{
+    static_assert(TypeTraits::IsStringLiteral<decltype(path)> || TypeTraits::IsString<decltype(path)> || TypeTraits::IsSmallString<decltype(path)> || TypeTraits::IsPath<decltype(path)>);
+    // TODO: Strengthen fn static checks.
+
+    #ifdef _WIN32
+        auto winPath = Helpers::ToWinPath(Helpers::ToThreadPath(Helpers::ToCStr(path)));
+        auto wStr = Helpers::ToWStr(winPath);
+        Windows::WIN32_FIND_DATAW fileData = {};
+        Windows::HANDLE handle = Windows::FindFirstFileW(wStr, &fileData);
+        free(wStr);
+        do { fn(Helpers::ToCStr(fileData.cFileName)); } while (Windows::FindNextFileW(handle, &fileData));
+        Windows::FindClose(handle);
+    #elif defined(__linux__)
+        // Mimic FindFirstFile(): the last path component is a wildcard pattern, and only file names are handed to fn.
+        Path directory(Helpers::ToCStr(path));
+        String<256> pattern;
+        pattern = directory.file_name();
+        directory.pop();
+
+        // A cached listing is a copy: fn may change the directory while it's being visited.
+        // Path drops "." components, so the current directory can't be stored in directory itself.
+        Array<char> names;
+        Helpers::ListDirectory(directory.is_empty() ? "." : directory, names);
+        String<256> fileName;
+        for (const char* name = names.begin(); name < names.end(); name += strlen(name) + 1)
+            if (fnmatch(pattern, name, FNM_PERIOD) == 0)
+            {
+                fileName = name;
+                fn(fileName);
+            }
+    #endif
+}
+
+
+
+inline void TraumaBuildSystem::v1::Experimental::FindFiles(const auto& path, Array<SmallString>& files)
+{
+    static_assert(TypeTraits::IsStringLiteral<decltype(path)> || TypeTraits::IsString<decltype(path)> || TypeTraits::IsSmallString<decltype(path)> || TypeTraits::IsPath<decltype(path)>);
+
+    SmallString directory = StripFileName(SmallString(Helpers::ToCStr(path)));
+    ForEachFile(path, [&] (const auto& name)
+    {
+        if (directory.is_empty())
+            files.push(SmallString(Helpers::ToCStr(name)));
+        else
+            files.push(directory / Helpers::ToCStr(name));
+    });
+}
+
+
+
+inline bool TraumaBuildSystem::v1::Experimental::DeleteFile(const auto& filename)
+{
+    static_assert(TypeTraits::IsStringLiteral<decltype(filename)> || TypeTraits::IsString<decltype(filename)> || TypeTraits::IsSmallString<decltype(filename)> || TypeTraits::IsPath<decltype(filename)>);
+
+    if (!IsValidPath(filename) || NotExists(filename)) return false;
+
+    #ifdef _WIN32
+        auto winFilename = Helpers::ToWinPath(Helpers::ToThreadPath(Helpers::ToCStr(filename)));
+        auto wStr = Helpers::ToWStr(winFilename);
+        bool success = Windows::DeleteFileW(wStr);
+        free(wStr);
+    #elif defined(__linux__)
+        bool success = unlinkat(Helpers::gThreadContext.directoryFd, Helpers::ToCStr(filename), 0) == 0;
+    #endif
+
+    Helpers::InvalidatePath(Helpers::ToCStr(filename));
+    return success;
+}
+
+
+
+inline bool TraumaBuildSystem::v1::Experimental::CopyFile(const auto& fromPath, const auto& toPath)
+{
+    static_assert(TypeTraits::IsStringLiteral<decltype(fromPath)> || TypeTraits::IsString<decltype(fromPath)> || TypeTraits::IsSmallString<decltype(fromPath)> || TypeTraits::IsPath<decltype(fromPath)>);
+    static_assert(TypeTraits::IsStringLiteral<decltype(toPath)> || TypeTraits::IsString<decltype(toPath)> || TypeTraits::IsSmallString<decltype(toPath)> || TypeTraits::IsPath<decltype(toPath)>);
+
+    if (!IsValidPath(fromPath) || !IsValidPath(toPath)) return false;
+
+    // The directories of toPath are only looked at when it can't be created.
+    auto CreateParentDirectory = [&]
+    {
+        SmallString directory = StripFileName(SmallString(Helpers::ToCStr(toPath)));
+        return !directory.is_empty() && NotExists(directory) && CreateDirectory(directory);
+    };
+
+    #ifdef _WIN32
+        auto winFrom = Helpers::ToWinPath(Helpers::ToThreadPath(Helpers::ToCStr(fromPath)));
+        auto wStrFrom = Helpers::ToWStr(winFrom);
+
+        auto winTo = Helpers::ToWinPath(Helpers::ToThreadPath(Helpers::ToCStr(toPath)));
+        auto wStrTo = Helpers::ToWStr(winTo);
+
+        // ReFS volumes clone blocks by themselves under CopyFileW().
+        bool success = Windows::CopyFileW(wStrFrom, wStrTo, FALSE);
+        if (!success && Windows::GetLastError() == ERROR_PATH_NOT_FOUND && CreateParentDirectory())
+            success = Windows::CopyFileW(wStrFrom, wStrTo, FALSE);
+        free(wStrFrom);
+        free(wStrTo);
+        Helpers::InvalidatePath(Helpers::ToCStr(toPath));
+        return success;
+    #elif defined(__linux__)
+        int from = openat(Helpers::gThreadContext.directoryFd, Helpers::ToCStr(fromPath), O_RDONLY | O_CLOEXEC);
+        if (from == -1)
+            return false;
+
+        // toPath is only truncated once it's known not to be fromPath itself, or a link to it, whose content would be lost.
+        struct stat fromStat;
+        struct stat toStat;
+        auto OpenTo = [&] { return openat(Helpers::gThreadContext.directoryFd, Helpers::ToCStr(toPath), O_WRONLY | O_CREAT | O_CLOEXEC, fromStat.st_mode & 0777); };
+        int to = fstat(from, &fromStat) == 0 ? OpenTo() : -1;
+        if (to == -1 && errno == ENOENT && CreateParentDirectory())
+            to = OpenTo();
+        bool sameFile = to != -1 && (fstat(to, &toStat) != 0 || (toStat.st_dev == fromStat.st_dev && toStat.st_ino == fromStat.st_ino));
+        if (to == -1 || sameFile || ftruncate(to, 0) != 0)
+        {
+            if (to != -1)
+                close(to);
+            close(from);
+            return false;
+        }
+
+        // A reflink shares the extents of fromPath until either file is written, on Btrfs and XFS. Otherwise copy_file_range() copies within
+        // the kernel, server side on NFS and SMB. Both can be unsupported between two file systems, and files like those of /proc report no
+        // content to copy_file_range(): read() and write() take over whenever nothing was copied.
+        bool copied = ioctl(to, FICLONE, from) == 0;
+        bool success = true;
+        for (off_t size = 0; success && !copied;)
+        {
+            ssize_t c = copy_file_range(from, nullptr, to, nullptr, 1 << 30, 0);
+            if (c > 0)
+                size += c;
+            else if (c == 0 && size > 0)
+                copied = true;
+            else if (c == -1 && errno == EINTR)
+                continue;
+            else if (size == 0)
+                break;
+            else
+                success = false;
+        }
+
+        char buffer[64 * 1024];
+        while (success && !copied)
+        {
+            ssize_t bytesRead = read(from, buffer, sizeof(buffer));
+            if (bytesRead == 0)
+                break;
+            if (bytesRead == -1)
+            {
+                success = errno == EINTR;
+                continue;
+            }
+
+            for (ssize_t bytesWritten = 0; success && bytesWritten < bytesRead;)
+            {
+                ssize_t c = write(to, buffer + bytesWritten, static_cast<size_t>(bytesRead - bytesWritten));
+                if (c > 0)
+                    bytesWritten += c;
+                else
+                    success = c == -1 && errno == EINTR;
+            }
+        }
+
+        close(from);
+        success = close(to) == 0 && success;
+        Helpers::InvalidatePath(Helpers::ToCStr(toPath));
+        return success;
+    #endif
+}
+
+
+
+inline TraumaBuildSystem::FileData TraumaBuildSystem::v1::Experimental::ReadFile(const auto& filename)
+{
+    FILE* f = Helpers::OpenFile(Helpers::ToCStr(filename), "rb");
+    if (!f)
+        return { nullptr, 0 };
+
+    // ftell() returns a long, which is 32 bits on Windows.
+    #ifdef _WIN32
+        _fseeki64(f, 0, SEEK_END);
+        auto fileSize = static_cast<size_t>(_ftelli64(f));
+        _fseeki64(f, 0, SEEK_SET);
+    #elif defined(__linux__)
+        fseeko(f, 0, SEEK_END);
+        auto fileSize = static_cast<size_t>(ftello(f));
+        fseeko(f, 0, SEEK_SET);
+    #endif
+
+    auto buffer = static_cast<char*>(malloc(fileSize + 1));
+    bool success = buffer && fread(buffer, 1, fileSize, f) == fileSize;
+    fclose(f);
+    if (!success)
+    {
+        free(buffer);
+        return { nullptr, 0 };
+    }
+
+    buffer[fileSize] = '\0';
+    return { buffer, fileSize };
+}
+
+
+
+inline TraumaBuildSystem::v1::Experimental::MappedFile& TraumaBuildSystem::v1::Experimental::MappedFile::operator=(MappedFile&& other)
+{
+    if (this != &other)
+    {
+        close();
+        mData = other.mData;
+        mSize = other.mSize;
+        mMapped = other.mMapped;
+        mOpen = other.mOpen;
+        other.mData = nullptr;
+        other.mSize = 0;
+        other.mMapped = false;
+        other.mOpen = false;
+    }
+    return *this;
+}
+
+
+
+inline bool TraumaBuildSystem::v1::Experimental::MappedFile::open(const auto& filename)
+{
+    static_assert(TypeTraits::IsStringLiteral<decltype(filename)> || TypeTraits::IsString<decltype(filename)> || TypeTraits::IsSmallString<decltype(filename)> || TypeTraits::IsPath<decltype(filename)>);
+
+    close();
+
+    #ifdef _WIN32
+        // The view stays valid once the file and the mapping are closed.
+        const auto invalidHandle = reinterpret_cast<Windows::HANDLE>(static_cast<Windows::LONG_PTR>(-1));
+        auto wStr = Helpers::ToWStr(Helpers::ToWinPath(Helpers::ToThreadPath(Helpers::ToCStr(filename))));
+        Windows::HANDLE file = Windows::CreateFileW(wStr, GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+        free(wStr);
+        Windows::LARGE_INTEGER fileSize = {};
+        if (file == invalidHandle || !Windows::GetFileSizeEx(file, &fileSize))
+        {
+            if (file != invalidHandle)
+                Windows::CloseHandle(file);
+            return false;
+        }
+
+        bool success = true;
+        size_t size = static_cast<size_t>(fileSize.QuadPart);
+        if (size >= MapThreshold)
+        {
+            Windows::HANDLE mapping = Windows::CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+            void* view = mapping ? Windows::MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) : nullptr;
+            if (mapping)
+                Windows::CloseHandle(mapping);
+            success = view != nullptr;
+            mData = static_cast<char*>(view);
+            mMapped = true;
+        }
+        else if (size > 0)
+        {
+            mData = static_cast<char*>(malloc(size));
+            Windows::DWORD bytesRead = 0;
+            success = mData && Windows::ReadFile(file, mData, static_cast<Windows::DWORD>(size), &bytesRead, nullptr) && bytesRead == size;
+            mMapped = false;
+        }
+        Windows::CloseHandle(file);
+    #elif defined(__linux__)
+        // The mapping stays valid once the file is closed.
+        int file = openat(Helpers::gThreadContext.directoryFd, Helpers::ToCStr(filename), O_RDONLY | O_CLOEXEC);
+        struct stat fileStat;
+        if (file == -1 || fstat(file, &fileStat) != 0)
+        {
+            if (file != -1)
+                ::close(file);
+            return false;
+        }
+
+        bool success = true;
+        size_t size = static_cast<size_t>(fileStat.st_size);
+        if (size >= MapThreshold)
+        {
+            void* view = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, file, 0);
+            success = view != MAP_FAILED;
+            if (success)
+                madvise(view, size, MADV_SEQUENTIAL);
+            mData = success ? static_cast<char*>(view) : nullptr;
+            mMapped = true;
+        }
+        else if (size > 0)
+        {
+            mData = static_cast<char*>(malloc(size));
+            size_t bytesRead = 0;
+            while (mData && bytesRead < size)
+            {
+                ssize_t c = pread(file, mData + bytesRead, size - bytesRead, static_cast<off_t>(bytesRead));
+                if (c > 0)
+                    bytesRead += static_cast<size_t>(c);
+                else if (c == 0 || errno != EINTR)
+                    break;
+            }
+            success = mData && bytesRead == size;
+            mMapped = false;
+        }
+        ::close(file);
+    #endif
+
+    mSize = size;
+    mOpen = success;
+    if (!success)
+        close();
+    return success;
+}
+
+
+
+inline void TraumaBuildSystem::v1::Experimental::MappedFile::close()
+{
+    if (mData && mMapped)
+    {
+        #ifdef _WIN32
+            Windows::UnmapViewOfFile(mData);
+        #elif defined(__linux__)
+            munmap(mData, mSize);
+        #endif
+    }
+    else
+        free(mData);
+
+    mData = nullptr;
+    mSize = 0;
+    mOpen = false;
+}
+
+
+
+inline void TraumaBuildSystem::v1::Experimental::EnableFileSystemCache(bool enable)
+{
+    InvalidateFileSystemCache();
+    if (enable)
+        Helpers::gFileSystemCache.workingDirectory = CurrentWorkingDirectory();
+    else
+        Helpers::gFileSystemCache.workingDirectory.clear();
+    Helpers::gFileSystemCache.enabled = enable;
+}
+
+
+
+inline void TraumaBuildSystem::v1::Experimental::InvalidateFileSystemCache()
+{
+    Helpers::FileSystemCache& cache = Helpers::gFileSystemCache;
+    Platform::LockMutex(cache.mutex);
+    for (Helpers::DirectoryListing& listing : cache.listings)
+        free(listing.names);
+    cache.entries.clear();
+    cache.entryCount = 0;
+    cache.listings.clear();
+    cache.listingCount = 0;
+    Platform::UnlockMutex(cache.mutex);
+}
+
+
+
+inline void TraumaBuildSystem::v1::Experimental::EnableTrace(bool enable)
+{
+    Helpers::TraceLog& trace = Helpers::gTraceLog;
+    Platform::LockMutex(trace.mutex);
+    trace.events.clear();
+    trace.slotCount = 0;
+    trace.startTime = Helpers::MonotonicTime();
+    Platform::UnlockMutex(trace.mutex);
+    Helpers::gTrace = enable ? &trace : nullptr;
+}
+
+
+
+inline bool TraumaBuildSystem::v1::Experimental::SaveTrace(const auto& filename)
+{
+    static_assert(TypeTraits::IsStringLiteral<decltype(filename)> || TypeTraits::IsString<decltype(filename)> || TypeTraits::IsSmallString<decltype(filename)> || TypeTraits::IsPath<decltype(filename)>);
+
+    Helpers::TraceLog* trace = Helpers::gTrace;
+    if (!trace)
+        return false;
+
+    FILE* f = Helpers::OpenFile(Helpers::ToCStr(filename), "wb");
+    if (!f)
+        return false;
+
+    // Slots are shown as threads, named so that the viewer doesn't label them with bare numbers.
+    Platform::LockMutex(trace->mutex);
+    bool success = fputs("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n", f) >= 0;
+    for (size_t i = 0; i < trace->slotCount; i++)
+        success = success && fprintf(f, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%zu,\"args\":{\"name\":\"Slot %zu\"}},\n", i, i) > 0;
+    // The last event is written without its trailing comma. Slots are only known from events, so there are no names without them.
+    size_t size = trace->events.is_empty() ? 0 : trace->events.size() - 2;
+    success = success && fwrite(trace->events.data(), 1, size, f) == size;
+    Platform::UnlockMutex(trace->mutex);
+
+    success = success && fputs("\n]}\n", f) >= 0;
+    success = fclose(f) == 0 && success;
+    Helpers::InvalidatePath(Helpers::ToCStr(filename));
+    return success;
+}
+
+
+
+inline bool TraumaBuildSystem::v1::Experimental::EnableObjectCache(const auto& directory)
+{
+    static_assert(TypeTraits::IsStringLiteral<decltype(directory)> || TypeTraits::IsString<decltype(directory)> || TypeTraits::IsSmallString<decltype(directory)> || TypeTraits::IsPath<decltype(directory)>);
+
+    if (NotExists(directory) && !CreateDirectory(directory))
+        return false;
+
+    // Compile() always runs g++, whichever g++ PATH resolves to is the one that counts.
+    String<1024> compilerIdentity;
+    Call("g++ --version", compilerIdentity);
+
+    Helpers::gObjectCache.directory = Helpers::ToCStr(directory);
+    Helpers::gObjectCache.compilerKey = Helpers::Hash(compilerIdentity, Length(compilerIdentity));
+    Helpers::gObjectCache.enabled = true;
+    return true;
+}
+
+
+
+inline void TraumaBuildSystem::v1::Experimental::DisableObjectCache()
+{
+    Helpers::gObjectCache.enabled = false;
+    Helpers::gObjectCache.directory.clear();
+}
+
+
+
+inline uint64 TraumaBuildSystem::v1::Experimental::Fingerprint(const auto& filename)
+{
+    static_assert(TypeTraits::IsStringLiteral<decltype(filename)> || TypeTraits::IsString<decltype(filename)> || TypeTraits::IsSmallString<decltype(filename)> || TypeTraits::IsPath<decltype(filename)>);
+
+    const char* const name = Helpers::ToCStr(filename);
+    Helpers::FileStamp stamp;
+    if (!Helpers::QueryFileStamp(name, stamp))
+        return 0;
+
+    uint64 pathHash = Helpers::Hash(name, strlen(name)) | 1;
+    Platform::LockMutex(Helpers::gFingerprints.mutex);
+    Helpers::FingerprintEntry* entry = Helpers::FindEntry(Helpers::gFingerprints.entries, pathHash);
+    bool known = entry && entry->pathHash == pathHash && memcmp(&entry->stamp, &stamp, sizeof(stamp)) == 0;
+    uint64 fingerprint = known ? entry->fingerprint : 0;
+    Platform::UnlockMutex(Helpers::gFingerprints.mutex);
+    if (known)
+        return fingerprint;
+
+    MappedFile file;
+    if (!file.open(name))
+        return 0;
+    fingerprint = Helpers::Hash(file.data(), file.size());
+
+    // A file written again within the resolution of its modification time would keep the same stamp with a different content.
+    // Recently modified files are hashed every time, until their stamp can be trusted.
+    #ifdef _WIN32
+        constexpr uint64 settleTime = 2 * 10000000ull;
+    #elif defined(__linux__)
+        constexpr uint64 settleTime = 2 * 1000000000ull;
+    #endif
+    if (stamp.time + settleTime < Helpers::CurrentFileTime())
+    {
+        Platform::LockMutex(Helpers::gFingerprints.mutex);
+        Helpers::StoreEntry(Helpers::gFingerprints.entries, Helpers::gFingerprints.count, { pathHash, stamp, fingerprint });
+        Platform::UnlockMutex(Helpers::gFingerprints.mutex);
+    }
+
+    return fingerprint;
+}
+
+
+
+inline void TraumaBuildSystem::v1::Experimental::Fingerprint(const auto* filenames, size_t count, uint64* fingerprints)
+{
+    using Filenames = decltype(filenames);
+    struct Batch
+    {
+        Filenames                       filenames;
+        uint64*                         fingerprints;
+        size_t                          count;
+        size_t                          next;
+    };
+
+    Batch batch = { filenames, fingerprints, count, 0 };
+    auto Work = [] (void* batchPtr)
+    {
+        auto& batch = *static_cast<Batch*>(batchPtr);
+        for (size_t i = __atomic_fetch_add(&batch.next, 1, __ATOMIC_RELAXED); i < batch.count; i = __atomic_fetch_add(&batch.next, 1, __ATOMIC_RELAXED))
+            batch.fingerprints[i] = Fingerprint(batch.filenames[i]);
+    };
+
+    // Files that didn't change only cost a stat, threads are worth starting for large batches only.
+    size_t workerCount = Platform::HardwareThreadCount();
+    if (workerCount > count / 16)
+        workerCount = count / 16;
+
+    // The calling thread is a worker too.
+    Array<ThreadHandle> threads;
+    for (size_t i = 1; i < workerCount; i++)
+        threads.push(Platform::StartThread(Work, &batch));
+    Work(&batch);
+    for (ThreadHandle thread : threads)
+        Platform::JoinThread(thread);
+}
+
+
+
+inline bool TraumaBuildSystem::v1::Experimental::LoadFingerprints(const auto& filename)
+{
+    static_assert(TypeTraits::IsStringLiteral<decltype(filename)> || TypeTraits::IsString<decltype(filename)> || TypeTraits::IsSmallString<decltype(filename)> || TypeTraits::IsPath<decltype(filename)>);
+
+    auto [buffer, size] = ReadFile(Helpers::ToCStr(filename));
+    if (!buffer)
+        return false;
+
+    constexpr size_t headerSize = sizeof(Helpers::FingerprintsMagic);
+    bool valid = size >= headerSize && memcmp(buffer, Helpers::FingerprintsMagic, headerSize) == 0 && (size - headerSize) % sizeof(Helpers::FingerprintEntry) == 0;
+    if (valid)
+    {
+        Platform::LockMutex(Helpers::gFingerprints.mutex);
+        for (size_t offset = headerSize; offset < size; offset += sizeof(Helpers::FingerprintEntry))
+        {
+            Helpers::FingerprintEntry entry;
+            memcpy(&entry, buffer + offset, sizeof(entry));
+            if (entry.pathHash != 0)
+                Helpers::StoreEntry(Helpers::gFingerprints.entries, Helpers::gFingerprints.count, entry);
+        }
+        Platform::UnlockMutex(Helpers::gFingerprints.mutex);
+    }
+
+    free(buffer);
+    return valid;
+}
+
+
+
+inline bool TraumaBuildSystem::v1::Experimental::SaveFingerprints(const auto& filename)
+{
+    static_assert(TypeTraits::IsStringLiteral<decltype(filename)> || TypeTraits::IsString<decltype(filename)> || TypeTraits::IsSmallString<decltype(filename)> || TypeTraits::IsPath<decltype(filename)>);
+
+    FILE* f = Helpers::OpenFile(Helpers::ToCStr(filename), "wb");
+    if (!f)
+        return false;
+
+    bool success = fwrite(Helpers::FingerprintsMagic, sizeof(Helpers::FingerprintsMagic), 1, f) == 1;
+    Platform::LockMutex(Helpers::gFingerprints.mutex);
+    for (const Helpers::FingerprintEntry& entry : Helpers::gFingerprints.entries)
+        if (entry.pathHash != 0)
+            success = success && fwrite(&entry, sizeof(entry), 1, f) == 1;
+    Platform::UnlockMutex(Helpers::gFingerprints.mutex);
+
+    success = fclose(f) == 0 && success;
+    Helpers::InvalidatePath(Helpers::ToCStr(filename));
+    return success;
+}
+
+
+
+inline TraumaBuildSystem::v1::Experimental::CommandLine& TraumaBuildSystem::v1::Experimental::CommandLine::add(const auto& argument)
+{
+    static_assert(TypeTraits::IsStringLiteral<decltype(argument)> || TypeTraits::IsString<decltype(argument)> || TypeTraits::IsSmallString<decltype(argument)> || TypeTraits::IsPath<decltype(argument)> || TypeTraits::IsCommandLine<decltype(argument)>);
+
+    if constexpr (TypeTraits::IsCommandLine<decltype(argument)>)
+    {
+        assert(&argument != this);
+
+        size_t base = mArguments.size();
+        mArguments.append(argument.data(), argument.length());
+        mOffsets.reserve(mOffsets.size() + argument.size());
+        for (size_t offset : argument.mOffsets)
+            mOffsets.push(base + offset);
+    }
+    else
+    {
+        mOffsets.push(mArguments.size());
+        mArguments.append(Helpers::ToCStr(argument), Length(argument) + 1);
+    }
+    return *this;
+}
+
+
+
+inline TraumaBuildSystem::v1::Experimental::CommandLine& TraumaBuildSystem::v1::Experimental::CommandLine::add(const auto& prefix, const auto& argument)
+{
+    static_assert(TypeTraits::IsStringLiteral<decltype(prefix)> || TypeTraits::IsString<decltype(prefix)> || TypeTraits::IsSmallString<decltype(prefix)>);
+    static_assert(TypeTraits::IsStringLiteral<decltype(argument)> || TypeTraits::IsString<decltype(argument)> || TypeTraits::IsSmallString<decltype(argument)> || TypeTraits::IsPath<decltype(argument)>);
+
+    mOffsets.push(mArguments.size());
+    mArguments.append(Helpers::ToCStr(prefix), Length(prefix));
+    mArguments.append(Helpers::ToCStr(argument), Length(argument) + 1);
+    return *this;
+}
+
+
+
+inline TraumaBuildSystem::v1::Experimental::CommandLine& TraumaBuildSystem::v1::Experimental::CommandLine::add_split(const auto& arguments)
+{
+    static_assert(TypeTraits::IsStringLiteral<decltype(arguments)> || TypeTraits::IsString<decltype(arguments)> || TypeTraits::IsSmallString<decltype(arguments)> || TypeTraits::IsCommandLine<decltype(arguments)>);
+
+    if constexpr (TypeTraits::IsCommandLine<decltype(arguments)>)
+        return add(arguments);
+    else
+    {
+        using Helpers::IsBlank;
+
+        // Arguments only shrink when split, so the buffer grows once at most.
+        const char* p = Helpers::ToCStr(arguments);
+        mArguments.reserve(mArguments.size() + Length(arguments) + 1);
+
+        while (true)
+        {
+            while (IsBlank(*p))
+                p++;
+            if (*p == '\0')
+                break;
+
+            mOffsets.push(mArguments.size());
+            char quote = '\0';
+            while (*p != '\0' && (quote != '\0' || !IsBlank(*p)))
+            {
+                if (quote == '\0' && (*p == '\"' || *p == '\''))
+                    quote = *p++;
+                else if (*p == quote)
+                {
+                    quote = '\0';
+                    p++;
+                }
+                else if (*p == '\\' && p[1] != '\0' && (quote == '\0' || (quote == '\"' && (p[1] == '\"' || p[1] == '\\'))))
+                {
+                    mArguments.push(p[1]);
+                    p += 2;
+                }
+                else
+                    mArguments.push(*p++);
+            }
+            mArguments.push('\0');
+        }
+        return *this;
+    }
+}
+
+
+
+inline void TraumaBuildSystem::v1::Experimental::CommandLine::join(Array<char>& commandLine, size_t firstArgument) const
+{
+    for (size_t i = firstArgument; i < size(); i++)
+    {
+        if (i > firstArgument)
+            commandLine.push(' ');
+
+        const char* argument = (*this)[i];
+        bool quoted = *argument == '\0';
+        for (const char* p = argument; *p != '\0' && !quoted; p++)
+            #ifdef _WIN32
+                quoted = Helpers::IsBlank(*p) || *p == '\"';
+            #else
+                quoted = !(('a' <= *p && *p <= 'z') || ('A' <= *p && *p <= 'Z') || ('0' <= *p && *p <= '9') || *p == '-' || *p == '_' || *p == '.' || *p == '/' || *p == '=' || *p == ',' || *p == ':' || *p == '+' || *p == '@');
+            #endif
+
+        if (!quoted)
+        {
+            commandLine.append(argument, Length(argument));
+            continue;
+        }
+
+        #ifdef _WIN32
+            // The rules of CommandLineToArgvW(): backslashes are literal unless they precede a quote, where they must be doubled.
+            commandLine.push('\"');
+            size_t backslashes = 0;
+            for (const char* p = argument; ; p++)
+            {
+                if (*p == '\\')
+                {
+                    backslashes++;
+                    continue;
+                }
+
+                size_t count = *p == '\"' || *p == '\0' ? backslashes * 2 : backslashes;
+                for (size_t k = 0; k < count; k++)
+                    commandLine.push('\\');
+                backslashes = 0;
+
+                if (*p == '\0')
+                    break;
+                if (*p == '\"')
+                    commandLine.push('\\');
+                commandLine.push(*p);
+            }
+            commandLine.push('\"');
+        #else
+            // Single quotes keep everything but themselves, which are closed, escaped and reopened.
+            commandLine.push('\'');
+            for (const char* p = argument; *p != '\0'; p++)
+            {
+                if (*p == '\'')
+                    commandLine.append("'\\''", 4);
+                else
+                    commandLine.push(*p);
+            }
+            commandLine.push('\'');
+        #endif
+    }
+    commandLine.push('\0');
+}
+
+
+
+inline auto TraumaBuildSystem::v1::Experimental::Compile(const auto& sourceFile, const auto& compilerFlags, const auto& includes)
+{
+    Scheduler scheduler;
+    Compile(scheduler, sourceFile, compilerFlags, includes);
+    scheduler.run(1);
+    return Helpers::StrCat(sourceFile, ".o");
+}
+
+
+
+inline TraumaBuildSystem::v1::Experimental::JobId TraumaBuildSystem::v1::Experimental::Compile(Scheduler& scheduler, const auto& sourceFile, const auto& compilerFlags, const auto& includes)
+{
+    static_assert(TypeTraits::IsStringLiteral<decltype(sourceFile)> || TypeTraits::IsString<decltype(sourceFile)> || TypeTraits::IsSmallString<decltype(sourceFile)>);
+
+    bool queued = false;
+    return Helpers::CompileObject(scheduler, sourceFile, sourceFile, compilerFlags, includes, queued);
+}
+
+
+
+inline bool TraumaBuildSystem::v1::Experimental::Build(const auto& artifact, const auto& source, const auto& compilerFlags, const auto& linkerFlags, const auto& includes, const auto& libsPath, const auto& libs)
+{
+    Scheduler scheduler;
+    Build(scheduler, artifact, source, compilerFlags, linkerFlags, includes, libsPath, libs);
+    return scheduler.run(1);
+}
+
+
+
+inline TraumaBuildSystem::v1::Experimental::JobId TraumaBuildSystem::v1::Experimental::Build(Scheduler& scheduler, const auto& artifact, const auto& source, const auto& compilerFlags, const auto& linkerFlags, const auto& includes, const auto& libsPath, const auto& libs)
+{
+    static_assert(TypeTraits::IsStringLiteral<decltype(artifact)> || TypeTraits::IsString<decltype(artifact)> || TypeTraits::IsSmallString<decltype(artifact)>);
+
+    printf("Building %s...\n", Helpers::ToCStr(artifact));
+    CommandLine sources;
+    sources.add_split(source);
+    for (size_t i = 0; i < sources.size(); i++)
+        Helpers::RecordDependencies(nullptr, sources[i]);
+
+    CommandLine cmd("g++");
+    cmd.add_split(linkerFlags).add_split(compilerFlags).add_split(includes).add_split(libsPath).add("-o").add(artifact).add_split(source).add_split(libs);
+    JobId job = scheduler.add(cmd);
+    scheduler.describe(job, "Build", artifact);
+    return job;
+}
+
+
+
+inline bool TraumaBuildSystem::v1::Experimental::Build(const auto& artifact, const auto& objectDirectory, const auto* sourceFiles, size_t count, const auto& compilerFlags, const auto& linkerFlags, const auto& includes, const auto& libsPath, const auto& libs)
+{
+    Scheduler scheduler;
+    Build(scheduler, artifact, objectDirectory, sourceFiles, count, compilerFlags, linkerFlags, includes, libsPath, libs);
+    return scheduler.run();
+}
+
+
+
+inline TraumaBuildSystem::v1::Experimental::JobId TraumaBuildSystem::v1::Experimental::Build(Scheduler& scheduler, const auto& artifact, const auto& objectDirectory, const auto* sourceFiles, size_t count, const auto& compilerFlags, const auto& linkerFlags, const auto& includes, const auto& libsPath, const auto& libs)
+{
+    static_assert(TypeTraits::IsStringLiteral<decltype(artifact)> || TypeTraits::IsString<decltype(artifact)> || TypeTraits::IsSmallString<decltype(artifact)>);
+    static_assert(TypeTraits::IsStringLiteral<decltype(objectDirectory)> || TypeTraits::IsString<decltype(objectDirectory)> || TypeTraits::IsSmallString<decltype(objectDirectory)> || TypeTraits::IsPath<decltype(objectDirectory)>);
+
+    CommandLine cmd("g++");
+    cmd.add_split(linkerFlags).add("-o").add(artifact);
+
+    // Objects mirror the sources' paths inside objectDirectory. Parent directories and drive letters can't appear there, so they are renamed.
+    Array<JobId> compiles;
+    bool objectsChanged = false;
+    uint64 newestObject = 0;
+    for (size_t i = 0; i < count; i++)
+    {
+        SmallString objectBase = SmallString(Helpers::ToCStr(objectDirectory)) / Helpers::ToCStr(sourceFiles[i]);
+        size_t relative = Length(Helpers::ToCStr(objectDirectory)) + 1;
+        for (size_t k = relative; k < objectBase.length(); k++)
+        {
+            bool componentStart = k == relative || objectBase[k - 1] == '/' || objectBase[k - 1] == '\\';
+            if (objectBase[k] == ':')
+                objectBase[k] = '_';
+            else if (componentStart && objectBase[k] == '.' && objectBase[k + 1] == '.' && (objectBase[k + 2] == '/' || objectBase[k + 2] == '\\'))
+                objectBase[k] = objectBase[k + 1] = '_';
+        }
+
+        if (SmallString directory = StripFileName(objectBase); NotExists(directory))
+            CreateDirectory(directory);
+
+        bool queued = false;
+        compiles.push(Helpers::CompileObject(scheduler, sourceFiles[i], objectBase, compilerFlags, includes, queued));
+        objectsChanged = objectsChanged || queued;
+
+        SmallString object = objectBase + ".o";
+        if (uint64 objectTime = LastModificationTime(object); objectTime > newestObject)
+            newestObject = objectTime;
+        cmd.add(object);
+    }
+    cmd.add_split(libsPath).add_split(libs);
+
+    // Like objects, the artifact records the hash of the command line that linked it.
+    auto commandFile = Helpers::StrCat(artifact, ".cmd");
+    auto commandHash = Helpers::ToHexString(Helpers::Hash(cmd.data(), cmd.length()));
+    auto [storedHash, storedHashSize] = ReadFile(commandFile);
+    bool sameCommand = storedHash && strcmp(storedHash, commandHash) == 0;
+    free(storedHash);
+
+    uint64 artifactTime = LastModificationTime(artifact);
+    bool upToDate = !objectsChanged && sameCommand && artifactTime != 0 && artifactTime >= newestObject;
+
+    JobId link = 0;
+    if (upToDate)
+        link = scheduler.add("");
+    else
+    {
+        printf("Linking %s...\n", Helpers::ToCStr(artifact));
+        DeleteFile(commandFile);
+        link = scheduler.add(cmd, commandFile, commandHash);
+        scheduler.describe(link, "Build", artifact);
+    }
+
+    for (JobId compile : compiles)
+        scheduler.add_dependency(link, compile);
+    return link;
+}
+
+
+
+inline bool TraumaBuildSystem::v1::Experimental::CompileUnity(const auto& unityDirectory, const auto* sourceFiles, size_t count, size_t batchSize, const auto& compilerFlags, const auto& includes, Array<SmallString>& objects)
+{
+    Scheduler scheduler;
+    CompileUnity(scheduler, unityDirectory, sourceFiles, count, batchSize, compilerFlags, includes, objects);
+    return scheduler.run();
+}
+
+
+
+inline TraumaBuildSystem::v1::Experimental::JobId TraumaBuildSystem::v1::Experimental::CompileUnity(Scheduler& scheduler, const auto& unityDirectory, const auto* sourceFiles, size_t count, size_t batchSize, const auto& compilerFlags, const auto& includes, Array<SmallString>& objects)
+{
+    static_assert(TypeTraits::IsStringLiteral<decltype(unityDirectory)> || TypeTraits::IsString<decltype(unityDirectory)> || TypeTraits::IsSmallString<decltype(unityDirectory)> || TypeTraits::IsPath<decltype(unityDirectory)>);
+
+    if (NotExists(unityDirectory))
+        CreateDirectory(unityDirectory);
+
+    // Generated files are in another directory, so the sources they include must be absolute.
+    SmallString cwd = CurrentWorkingDirectory();
+    Array<SmallString> sources;
+    sources.reserve(count);
+    for (size_t i = 0; i < count; i++)
+    {
+        const char* source = Helpers::ToCStr(sourceFiles[i]);
+        #ifdef _WIN32
+            bool absolute = source[0] == '/' || source[0] == '\\' || (source[0] != '\0' && source[1] == ':');
+        #else
+            bool absolute = source[0] == '/';
+        #endif
+        sources.push(absolute ? SmallString(source) : cwd / source);
+        sources.back().replace('\\', '/');
+    }
+    Helpers::Sort(sources.data(), sources.size(), [] (const SmallString& a, const SmallString& b) { return strcmp(a, b) < 0; });
+
+    // Content defined boundaries: whether a source ends its batch only depends on its own path. Batches are capped at 4 times
+    // the average, a cut forced by the cap only moves boundaries up to the next source that ends a batch by itself.
+    if (batchSize == 0)
+        batchSize = 1;
+    JobId done = scheduler.add("");
+    SmallString content;
+    size_t batchCount = 0;
+    for (size_t i = 0; i < sources.size(); i++)
+    {
+        const SmallString& source = sources[i];
+        uint64 pathHash = Helpers::Hash(source, source.length());
+        content.append("#include \"");
+        content.append(source, source.length());
+        content.append("\"\n");
+        batchCount++;
+
+        if (pathHash % batchSize != 0 && batchCount < batchSize * 4 && i + 1 < sources.size())
+            continue;
+
+        // Batches are named after the source that ended them, and only written when they change, so that Compile() can skip them.
+        SmallString unityFile(Helpers::ToCStr(unityDirectory));
+        unityFile.append("/Unity-");
+        unityFile += Helpers::ToHexString(pathHash);
+        unityFile.append(".cpp");
+
+        auto [oldContent, oldContentSize] = ReadFile(unityFile);
+        bool changed = !oldContent || oldContentSize != content.length() || memcmp(oldContent, content, oldContentSize) != 0;
+        free(oldContent);
+        if (changed)
+            if (FILE* f = Helpers::OpenFile(unityFile, "wb"))
+            {
+                fwrite(content, 1, content.length(), f);
+                fclose(f);
+                Helpers::InvalidatePath(unityFile);
+            }
+
+        scheduler.add_dependency(done, Compile(scheduler, unityFile, compilerFlags, includes));
+        objects.push(unityFile + ".o");
+        content.clear();
+        batchCount = 0;
+    }
+    return done;
+}
+
+
+
+template <size_t Size>
+inline void TraumaBuildSystem::v1::Experimental::Call(const auto& cmd, String<Size>& output)
+{
+    static_assert(TypeTraits::IsStringLiteral<decltype(cmd)> || TypeTraits::IsString<decltype(cmd)> || TypeTraits::IsSmallString<decltype(cmd)> || TypeTraits::IsCommandLine<decltype(cmd)>);
+    static_assert(Size > 0);
+
+    // Whatever doesn't fit is still read and dropped, so the child never blocks on a write.
+    size_t c = 0;
+    CallStreaming(cmd, [&] (const char* data, size_t size)
+    {
+        size_t count = c + size < Size - 1 ? size : Size - 1 - c;
+        memcpy(output.data() + c, data, count);
+        c += count;
+    });
+
+    while (c > 0 && (output[c - 1] == '\n' || output[c - 1] == '\r'))
+        c--;
+    output[c] = '\0';
+}
+
+
+
+inline int TraumaBuildSystem::v1::Experimental::Call(const auto& cmd, Array<char>& output)
+{
+    int exitCode = CallStreaming(cmd, [&] (const char* data, size_t size) { output.append(data, size); });
+
+    // Leave a terminator right past the end, this also makes sure data() is never nullptr.
+    output.push('\0');
+    output.pop();
+
+    return exitCode;
+}
+
+
+
+inline int TraumaBuildSystem::v1::Experimental::CallStreaming(const auto& cmd, auto&& fn)
+{
+    static_assert(TypeTraits::IsStringLiteral<decltype(cmd)> || TypeTraits::IsString<decltype(cmd)> || TypeTraits::IsSmallString<decltype(cmd)> || TypeTraits::IsCommandLine<decltype(cmd)>);
+
+    char buffer[64 * 1024];
+
+    char* responseFile = nullptr;
+    uint64 startTime = Helpers::MonotonicTime();
+
+    #ifdef _WIN32
+        // https://gcc.gnu.org/onlinedocs/gcc/Diagnostic-Message-Formatting-Options.html#Diagnostic-Message-Formatting-Options
+        Array<char> commandString;
+        Helpers::ToCommandString(cmd, commandString, responseFile);
+        commandString.pop();
+        commandString.append(" 2>&1", sizeof(" 2>&1")); // Redirects stderr
+        FILE* pipe = popen(Helpers::ToShellCommand(commandString.data()), "r");
+        if (!pipe) // TODO: Manage error.
+        {
+            Helpers::DeleteResponseFile(responseFile);
+            return -1;
+        }
+
+        while (size_t bytesRead = fread(buffer, 1, sizeof(buffer), pipe))
+            fn(static_cast<const char*>(buffer), bytesRead);
+
+        int exitCode = pclose(pipe);
+    #elif defined(__linux__)
+        int pipeFds[2];
+        if (pipe2(pipeFds, O_CLOEXEC) == -1) // TODO: Manage error.
+            return -1;
+
+        pid_t pid = Helpers::SpawnProcess(cmd, pipeFds[1], responseFile);
+        close(pipeFds[1]);
+
+        while (pid != -1)
+        {
+            ssize_t bytesRead = read(pipeFds[0], buffer, sizeof(buffer));
+            if (bytesRead > 0)
+                fn(static_cast<const char*>(buffer), static_cast<size_t>(bytesRead));
+            else if (bytesRead == 0 || errno != EINTR)
+                break;
+        }
+        close(pipeFds[0]);
+
+        int exitCode = pid != -1 ? Helpers::WaitProcess(pid) : -1;
+    #endif
+
+    Helpers::DeleteResponseFile(responseFile);
+    InvalidateFileSystemCache();
+
+    if (Helpers::gTrace)
+    {
+        Array<char> command, name;
+        Helpers::TraceCommand(cmd, command, name);
+        Helpers::RecordTrace("Call", name.data(), command.data(), startTime, exitCode);
+    }
+    return exitCode;
+}
+
+
+
+inline int TraumaBuildSystem::v1::Experimental::CallStreamingLines(const auto& cmd, auto&& fn)
+{
+    // Complete lines are handed out straight from the read buffer, only a line split across two reads is assembled here.
+    Array<char> partialLine;
+    auto EmitLine = [&] (const char* line, size_t size)
+    {
+        if (size > 0 && line[size - 1] == '\r')
+            size--;
+        fn(line, size);
+    };
+
+    int exitCode = CallStreaming(cmd, [&] (const char* data, size_t size)
+    {
+        const char* end = data + size;
+        while (data < end)
+        {
+            auto newline = static_cast<const char*>(memchr(data, '\n', static_cast<size_t>(end - data)));
+            if (!newline)
+            {
+                partialLine.append(data, static_cast<size_t>(end - data));
+                break;
+            }
+
+            if (partialLine.is_empty())
+                EmitLine(data, static_cast<size_t>(newline - data));
+            else
+            {
+                partialLine.append(data, static_cast<size_t>(newline - data));
+                EmitLine(partialLine.data(), partialLine.size());
+                partialLine.clear();
+            }
+            data = newline + 1;
+        }
+    });
+
+    if (!partialLine.is_empty())
+        EmitLine(partialLine.data(), partialLine.size());
+
+    return exitCode;
+}
+
+
+
+inline void TraumaBuildSystem::v1::Experimental::Call(const auto& cmd)
+{
+    static_assert(TypeTraits::IsStringLiteral<decltype(cmd)> || TypeTraits::IsString<decltype(cmd)> || TypeTraits::IsSmallString<decltype(cmd)> || TypeTraits::IsCommandLine<decltype(cmd)>);
+
+    uint64 startTime = Helpers::MonotonicTime();
+    int exitCode = -1;
+
+    #ifdef _WIN32
+        // TODO: system() is not safe, use something else.
+        if constexpr (TypeTraits::IsCommandLine<decltype(cmd)>)
+            exitCode = Platform::RunProcess(cmd);
+        else
+            exitCode = system(Helpers::ToShellCommand(Helpers::ToCStr(cmd)));
+    #elif defined(__linux__)
+        char* responseFile = nullptr;
+        if (pid_t pid = Helpers::SpawnProcess(cmd, -1, responseFile);
+            pid != -1)
+            exitCode = Helpers::WaitProcess(pid);
+        Helpers::DeleteResponseFile(responseFile);
+    #endif
+
+    v1::Experimental::InvalidateFileSystemCache();
+
+    if (Helpers::gTrace)
+    {
+        Array<char> command, name;
+        Helpers::TraceCommand(cmd, command, name);
+        Helpers::RecordTrace("Call", name.data(), command.data(), startTime, exitCode);
+    }
+}
+
+
+
+inline void TraumaBuildSystem::v1::Experimental::ClearConsole()
+{
+    #ifdef _WIN32
+        Call("cls");
+    #elif defined(__linux__)
+        // Same as "clear", minus the process launch.
+        printf("\033[H\033[2J\033[3J");
+        fflush(stdout);
+    #endif
+}
+
+
+
+inline void TraumaBuildSystem::v1::Experimental::Print(const auto& message, ...)
+{
+    static_assert(TypeTraits::IsStringLiteral<decltype(message)> || TypeTraits::IsString<decltype(message)> || TypeTraits::IsSmallString<decltype(message)>);
+
+    va_list args;
+    va_start(args, message);
+    if constexpr (TypeTraits::IsString<decltype(message)>)
+        vprintf(message.c_str(), args);
+    else
+        vprintf(message, args);
+    va_end(args);
+}
+
+
+
+inline void TraumaBuildSystem::v1::Experimental::Println(const auto& message, ...)
+{
+    static_assert(TypeTraits::IsStringLiteral<decltype(message)> || TypeTraits::IsString<decltype(message)> || TypeTraits::IsSmallString<decltype(message)>);
+
+    va_list args;
+    va_start(args, message);
+    if constexpr (TypeTraits::IsString<decltype(message)>)
+        vprintf((message + "\n").c_str(), args);
+    else
+    {
+        vprintf(message, args);
+        printf("\n");
+    }
+    va_end(args);
+}
+
+
+
+inline void TraumaBuildSystem::v1::Experimental::Println()
+{
+    printf("\n");
+}
+
+
+
+inline auto TraumaBuildSystem::v1::Experimental::SVN::CurrentRevision()
+{
+    // FIXME: This currently returns the HEAD revision, not the the Working Copy's.
+    String<16> rev;
+    TraumaBuildSystem::v1::Experimental::Call("svn info -rHEAD --show-item revision", rev);
+    return rev;
+}
+
+
+
+inline auto TraumaBuildSystem::v1::Experimental::SVN::CurrentRevision(const auto& path)
+{
+    // FIXME: This currently returns the HEAD revision, not the the Working Copy's.
+    String<16> rev;
+    if (!IsValidPath(path))
+        return rev;
+
+    // Only the calling thread moves, other threads keep resolving paths as before.
+    SmallString directory = Helpers::gThreadContext.directory;
+    if (SetThreadDirectory(path))
+        rev = CurrentRevision();
+    if (directory.is_empty())
+        ResetThreadDirectory();
+    else
+        SetThreadDirectory(directory);
+    return rev;
+}
+
+
+
+inline DynamicLibrary TraumaBuildSystem::Platform::LoadLibrary(const auto& filename)
+{
+    static_assert(TypeTraits::IsStringLiteral<decltype(filename)> || TypeTraits::IsString<decltype(filename)> || TypeTraits::IsSmallString<decltype(filename)> || TypeTraits::IsPath<decltype(filename)>);
+
+    #ifdef _WIN32
+        auto winFilename = Helpers::ToWinPath(Helpers::ToThreadPath(Helpers::ToCStr(filename)));
+        Windows::LPWSTR wStr = Helpers::ToWStr(winFilename);
+        Windows::HMODULE handle = Windows::LoadLibraryW(wStr);
+        free(wStr);
+        return handle;
+    #elif defined(__linux__)
+        return dlopen(Helpers::ToThreadPath(Helpers::ToCStr(filename)), RTLD_NOW | RTLD_LOCAL);
+    #endif
+}
+
+
+
+inline void TraumaBuildSystem::Platform::FreeLibrary(DynamicLibrary library)
+{
+    #ifdef _WIN32
+        Windows::FreeLibrary(library);
+    #elif defined(__linux__)
+        dlclose(library);
+    #endif
+}
+
+
+
+inline TraumaBuildSystem::Platform::VoidFnPtr TraumaBuildSystem::Platform::GetFunction(DynamicLibrary library, const char* const functionName)
+{
+    assert(functionName);
+
+    #ifdef _WIN32
+        return reinterpret_cast<VoidFnPtr>(GetProcAddress(library, functionName));
+    #elif defined(__linux__)
+        return reinterpret_cast<VoidFnPtr>(dlsym(library, functionName));
+    #endif
+}
+
+
+
+template <typename FunctionPointer>
+inline FunctionPointer TraumaBuildSystem::Platform::GetFunction(DynamicLibrary library, const char* const functionName)
+{
+    static_assert(TypeTraits::IsPointer<FunctionPointer>);
+    // static_assert(TypeTraits::IsFunction<std::remove_pointer_t<FunctionPointer>>); // FIXME
+    assert(functionName);
+    return reinterpret_cast<FunctionPointer>(GetFunction(library, functionName));
+}
+
+
+
+inline ThreadHandle TraumaBuildSystem::Platform::StartThread(ThreadFnPtr fn, void* data)
+{
+    assert(fn);
+
+    // The new thread starts in the context of the calling one.
+    struct ThreadStart
+    {
+        ThreadFnPtr                 fn;
+        void*                       data;
+        SmallString                 directory;
+        Array<SmallString>          environment;
+
+        void run()
+        {
+            if (!directory.is_empty())
+                v1::Experimental::SetThreadDirectory(directory);
+            Helpers::gThreadContext.environment = static_cast<Array<SmallString>&&>(environment);
+
+            ThreadFnPtr startFn = fn;
+            void* startData = data;
+            delete this;
+            startFn(startData);
+        }
+    };
+
+    auto start = new ThreadStart{ fn, data, Helpers::gThreadContext.directory, {} };
+    start->environment.append(Helpers::gThreadContext.environment.data(), Helpers::gThreadContext.environment.size());
+
+    #ifdef _WIN32
+        auto Trampoline = [] (Windows::LPVOID startPtr) -> Windows::DWORD
+        {
+            static_cast<ThreadStart*>(startPtr)->run();
+            return 0;
+        };
+
+        Windows::HANDLE thread = Windows::CreateThread(nullptr, 0, Trampoline, start, 0, nullptr);
+        assert(thread); // TODO: Manage error.
+        return thread;
+    #elif defined(__linux__)
+        auto Trampoline = [] (void* startPtr) -> void*
+        {
+            static_cast<ThreadStart*>(startPtr)->run();
+            return nullptr;
+        };
+
+        pthread_t thread = {};
+        [[maybe_unused]] int error = pthread_create(&thread, nullptr, Trampoline, start);
+        assert(error == 0); // TODO: Manage error.
+        return thread;
+    #endif
+}
+
+
+
+inline void TraumaBuildSystem::Platform::JoinThread(ThreadHandle thread)
+{
+    #ifdef _WIN32
+        Windows::WaitForSingleObject(thread, INFINITE);
+        Windows::CloseHandle(thread);
+    #elif defined(__linux__)
+        pthread_join(thread, nullptr);
+    #endif
+}
+
+
+
+inline size_t TraumaBuildSystem::Platform::HardwareThreadCount()
+{
+    size_t count = 0;
+
+    #ifdef _WIN32
+        count = Windows::GetActiveProcessorCount(ALL_PROCESSOR_GROUPS);
+    #elif defined(__linux__)
+        // The affinity mask honours taskset and container CPU limits, unlike the number of online processors.
+        cpu_set_t cpuSet;
+        if (sched_getaffinity(0, sizeof(cpuSet), &cpuSet) == 0)
+            count = static_cast<size_t>(CPU_COUNT(&cpuSet));
+        else if (long online = sysconf(_SC_NPROCESSORS_ONLN); online > 0)
+            count = static_cast<size_t>(online);
+    #endif
+
+    return count > 0 ? count : 1;
+}
+
+
+
+inline int TraumaBuildSystem::Platform::RunProcess(const auto& cmd, const char* const outputFilename)
+{
+    static_assert(TypeTraits::IsStringLiteral<decltype(cmd)> || TypeTraits::IsString<decltype(cmd)> || TypeTraits::IsSmallString<decltype(cmd)> || TypeTraits::IsCommandLine<decltype(cmd)>);
+
+    #ifdef _WIN32
+        // Macros like INVALID_HANDLE_VALUE can't be used, their types live in the Windows namespace.
+        const auto invalidHandle = reinterpret_cast<Windows::HANDLE>(static_cast<Windows::LONG_PTR>(-1));
+
+        Windows::HANDLE output = invalidHandle;
+        if (outputFilename)
+        {
+            Windows::SECURITY_ATTRIBUTES security = { sizeof(security), nullptr, TRUE };
+            auto wStrOutput = Helpers::ToWStr(Helpers::ToWinPath(outputFilename));
+            output = Windows::CreateFileW(wStrOutput, GENERIC_WRITE, FILE_SHARE_READ, &security, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+            free(wStrOutput);
+            if (output == invalidHandle)
+                return -1;
+        }
+
+        Windows::STARTUPINFOW startupInfo = {};
+        startupInfo.cb = sizeof(startupInfo);
+        if (output != invalidHandle)
+        {
+            startupInfo.dwFlags = STARTF_USESTDHANDLES;
+            startupInfo.hStdInput = Windows::GetStdHandle(static_cast<Windows::DWORD>(-10)); // STD_INPUT_HANDLE
+            startupInfo.hStdOutput = output;
+            startupInfo.hStdError = output;
+        }
+
+        Windows::PROCESS_INFORMATION processInfo = {};
+        Array<char> commandString;
+        char* responseFile = nullptr;
+        Helpers::ToCommandString(cmd, commandString, responseFile);
+        auto wStrCmd = Helpers::ToWStr(commandString.data());
+        Windows::LPWSTR wStrDirectory = Helpers::gThreadContext.directory.is_empty() ? nullptr : Helpers::ToWStr(Helpers::ToWinPath(Helpers::gThreadContext.directory));
+        Windows::LPWSTR environment = Helpers::ToEnvironmentBlock();
+        bool started = Windows::CreateProcessW(nullptr, wStrCmd, nullptr, nullptr, TRUE, CREATE_UNICODE_ENVIRONMENT, environment, wStrDirectory, &startupInfo, &processInfo);
+        free(wStrCmd);
+        free(wStrDirectory);
+        free(environment);
+        if (output != invalidHandle)
+            Windows::CloseHandle(output);
+
+        if (!started)
+        {
+            Helpers::DeleteResponseFile(responseFile);
+            return -1;
+        }
+
+        Windows::DWORD exitCode = 0;
+        Windows::WaitForSingleObject(processInfo.hProcess, INFINITE);
+        Windows::GetExitCodeProcess(processInfo.hProcess, &exitCode);
+        Windows::CloseHandle(processInfo.hThread);
+        Windows::CloseHandle(processInfo.hProcess);
+        Helpers::DeleteResponseFile(responseFile);
+        v1::Experimental::InvalidateFileSystemCache();
+        return static_cast<int>(exitCode);
+    #elif defined(__linux__)
+        int output = -1;
+        if (outputFilename)
+        {
+            output = openat(Helpers::gThreadContext.directoryFd, outputFilename, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+            if (output == -1)
+                return -1;
+        }
+
+        char* responseFile = nullptr;
+        pid_t pid = Helpers::SpawnProcess(cmd, output, responseFile);
+        if (output != -1)
+            close(output);
+
+        int exitCode = pid != -1 ? Helpers::WaitProcess(pid) : -1;
+        Helpers::DeleteResponseFile(responseFile);
+        v1::Experimental::InvalidateFileSystemCache();
+        return exitCode;
+    #endif
+}
+
+
+
+inline void TraumaBuildSystem::Platform::LockMutex(MutexHandle& mutex)
+{
+    #ifdef _WIN32
+        Windows::AcquireSRWLockExclusive(&mutex);
+    #elif defined(__linux__)
+        pthread_mutex_lock(&mutex);
+    #endif
+}
+
+
+
+inline void TraumaBuildSystem::Platform::UnlockMutex(MutexHandle& mutex)
+{
+    #ifdef _WIN32
+        Windows::ReleaseSRWLockExclusive(&mutex);
+    #elif defined(__linux__)
+        pthread_mutex_unlock(&mutex);
+    #endif
+}
+
+
+
+inline void TraumaBuildSystem::Platform::WaitCondition(ConditionHandle& condition, MutexHandle& mutex)
+{
+    #ifdef _WIN32
+        Windows::SleepConditionVariableSRW(&condition, &mutex, INFINITE, 0);
+    #elif defined(__linux__)
+        pthread_cond_wait(&condition, &mutex);
+    #endif
+}
+
+
+
+inline void TraumaBuildSystem::Platform::WakeAll(ConditionHandle& condition)
+{
+    #ifdef _WIN32
+        Windows::WakeAllConditionVariable(&condition);
+    #elif defined(__linux__)
+        pthread_cond_broadcast(&condition);
+    #endif
+}
+
+
+
+inline TraumaBuildSystem::v1::Experimental::Scheduler::~Scheduler()
+{
+    for (Job& job : mJobs)
+    {
+        free(job.command);
+        free(job.stampFile);
+        free(job.stampContent);
+        free(job.name);
+        free(job.outputFile);
+    }
+}
+
+
+
+inline TraumaBuildSystem::v1::Experimental::JobId TraumaBuildSystem::v1::Experimental::Scheduler::add(const auto& cmd, const char* const stampFile, const char* const stampContent)
+{
+    static_assert(TypeTraits::IsStringLiteral<decltype(cmd)> || TypeTraits::IsString<decltype(cmd)> || TypeTraits::IsSmallString<decltype(cmd)> || TypeTraits::IsCommandLine<decltype(cmd)>);
+
+    auto Duplicate = [] (const char* const string) -> char*
+    {
+        if (!string)
+            return nullptr;
+
+        size_t size = Length(string) + 1;
+        auto duplicate = static_cast<char*>(malloc(size));
+        memcpy(duplicate, string, size);
+        return duplicate;
+    };
+
+    if constexpr (TypeTraits::IsCommandLine<decltype(cmd)>)
+    {
+        mJobs.push({ nullptr, {}, Duplicate(stampFile), Duplicate(stampContent), "Job", nullptr, nullptr, nullptr, {}, {}, 0, false, SkippedExitCode });
+        mJobs.back().arguments.add(cmd);
+    }
+    else
+        mJobs.push({ Duplicate(Helpers::ToCStr(cmd)), {}, Duplicate(stampFile), Duplicate(stampContent), "Job", nullptr, nullptr, nullptr, {}, {}, 0, false, SkippedExitCode });
+    return mJobs.size() - 1;
+}
+
+
+
+inline void TraumaBuildSystem::v1::Experimental::Scheduler::add_dependency(JobId job, JobId dependency)
+{
+    assert(job < mJobs.size() && dependency < mJobs.size() && job != dependency);
+
+    mJobs[dependency].dependents.push(job);
+    mJobs[job].dependencies++;
+}
+
+
+
+inline void TraumaBuildSystem::v1::Experimental::Scheduler::describe(JobId job, const char* const category, const auto& name)
+{
+    static_assert(TypeTraits::IsStringLiteral<decltype(name)> || TypeTraits::IsString<decltype(name)> || TypeTraits::IsSmallString<decltype(name)> || TypeTraits::IsPath<decltype(name)>);
+    assert(job < mJobs.size() && category);
+
+    size_t size = Length(name) + 1;
+    free(mJobs[job].name);
+    mJobs[job].category = category;
+    mJobs[job].name = static_cast<char*>(malloc(size));
+    memcpy(mJobs[job].name, Helpers::ToCStr(name), size);
+}
+
+
+
+inline void TraumaBuildSystem::v1::Experimental::Scheduler::capture_output(JobId job, const auto& outputFile)
+{
+    static_assert(TypeTraits::IsStringLiteral<decltype(outputFile)> || TypeTraits::IsString<decltype(outputFile)> || TypeTraits::IsSmallString<decltype(outputFile)> || TypeTraits::IsPath<decltype(outputFile)>);
+    assert(job < mJobs.size());
+
+    size_t size = Length(outputFile) + 1;
+    free(mJobs[job].outputFile);
+    mJobs[job].outputFile = static_cast<char*>(malloc(size));
+    memcpy(mJobs[job].outputFile, Helpers::ToCStr(outputFile), size);
+}
+
+
+
+inline void TraumaBuildSystem::v1::Experimental::Scheduler::on_exit(JobId job, JobFnPtr fn, const CommandLine& arguments)
+{
+    assert(job < mJobs.size() && fn);
+
+    mJobs[job].onExit = fn;
+    mJobs[job].onExitArguments.clear();
+    mJobs[job].onExitArguments.add(arguments);
+}
+
+
+
+inline bool TraumaBuildSystem::v1::Experimental::Scheduler::run(size_t workerCount, bool keepGoing)
+{
+    using namespace TraumaBuildSystem::Platform;
+
+    if (mJobs.is_empty())
+        return true;
+
+    if (workerCount == 0)
+        workerCount = HardwareThreadCount();
+
+    // Every job is queued exactly once, so a queue as large as the whole job list never overflows.
+    struct WorkQueue
+    {
+        MutexHandle                 mutex                           = {};
+        JobId*                      jobs                            = nullptr;
+        size_t                      top                             = 0;        // Oldest job, where thieves take from.
+        size_t                      bottom                          = 0;        // Newest job, where the owner pushes and pops.
+    };
+
+    struct RunState
+    {
+        Array<Job>&                 jobs;
+        WorkQueue*                  queues;
+        size_t                      queueCount;
+        bool                        keepGoing;
+
+        MutexHandle                 mutex                           = {};       // Only protects sleeping and waking up.
+        ConditionHandle             wakeUp                          = {};
+
+        size_t                      queued                          = 0;        // Jobs sitting in a queue.
+        size_t                      busy                            = 0;        // Workers holding a job.
+        size_t                      remaining                       = 0;        // Jobs not completed yet.
+        bool                        stop                            = false;
+        bool                        success                         = true;
+
+        void push(size_t queueIndex, JobId job)
+        {
+            WorkQueue& queue = queues[queueIndex];
+            LockMutex(queue.mutex);
+            queue.jobs[queue.bottom++] = job;
+            UnlockMutex(queue.mutex);
+            __atomic_add_fetch(&queued, 1, __ATOMIC_SEQ_CST);
+        }
+
+        // The worker counts as busy before the job stops counting as queued, so that idle workers never see both at zero while there is still work around.
+        bool take(size_t queueIndex, JobId& job, bool steal)
+        {
+            WorkQueue& queue = queues[queueIndex];
+            LockMutex(queue.mutex);
+            bool found = queue.bottom > queue.top;
+            if (found)
+                job = steal ? queue.jobs[queue.top++] : queue.jobs[--queue.bottom];
+            UnlockMutex(queue.mutex);
+
+            if (found)
+            {
+                __atomic_add_fetch(&busy, 1, __ATOMIC_SEQ_CST);
+                __atomic_sub_fetch(&queued, 1, __ATOMIC_SEQ_CST);
+            }
+            return found;
+        }
+    };
+
+    // Workers get their index up front, so that the calling thread is always worker 0: on the build timeline its jobs nest inside whatever it was doing.
+    struct Worker
+    {
+        RunState*                   state;
+        size_t                      index;
+    };
+
+    auto Work = [] (void* data)
+    {
+        auto& state = *static_cast<Worker*>(data)->state;
+        size_t self = static_cast<Worker*>(data)->index;
+        size_t previousSlot = Helpers::gTraceSlot;
+        Helpers::gTraceSlot = self;
+
+        while (true)
+        {
+            JobId id = 0;
+            bool found = state.take(self, id, false);
+            for (size_t i = 1; !found && i < state.queueCount; i++)
+                found = state.take((self + i) % state.queueCount, id, true);
+
+            if (!found)
+            {
+                LockMutex(state.mutex);
+                while (__atomic_load_n(&state.queued, __ATOMIC_SEQ_CST) == 0 && __atomic_load_n(&state.remaining, __ATOMIC_SEQ_CST) > 0 && __atomic_load_n(&state.busy, __ATOMIC_SEQ_CST) > 0)
+                    WaitCondition(state.wakeUp, state.mutex);
+
+                // Nothing queued and nobody left to queue anything: either everything is done, or the rest is stuck in a dependency cycle.
+                bool done = __atomic_load_n(&state.queued, __ATOMIC_SEQ_CST) == 0 && __atomic_load_n(&state.busy, __ATOMIC_SEQ_CST) == 0;
+                if (done && __atomic_load_n(&state.remaining, __ATOMIC_SEQ_CST) > 0)
+                    state.success = false;
+                UnlockMutex(state.mutex);
+
+                if (done)
+                {
+                    WakeAll(state.wakeUp);
+                    Helpers::gTraceSlot = previousSlot;
+                    return;
+                }
+                continue;
+            }
+
+            Job& job = state.jobs[id];
+            bool skip = __atomic_load_n(&job.dependencyFailed, __ATOMIC_ACQUIRE) || __atomic_load_n(&state.stop, __ATOMIC_RELAXED);
+            bool empty = job.command ? job.command[0] == '\0' : job.arguments.is_empty();
+            uint64 startTime = Helpers::MonotonicTime();
+            if (skip)
+                job.exitCode = SkippedExitCode;
+            else if (empty)
+                job.exitCode = 0;
+            else if (!job.command)
+                job.exitCode = RunProcess(job.arguments, job.outputFile);
+            else
+                job.exitCode = RunProcess(job.command, job.outputFile);
+
+            if (job.outputFile && !skip && !empty)
+            {
+                auto [output, outputSize] = ReadFile(job.outputFile);
+                if (output)
+                {
+                    fwrite(output, 1, outputSize, stdout);
+                    fflush(stdout);
+                    free(output);
+                }
+            }
+
+            // Only jobs that ran something take time worth showing.
+            if (Helpers::gTrace && !skip && !empty)
+            {
+                Array<char> command, name;
+                if (job.command)
+                    Helpers::TraceCommand(job.command, command, name);
+                else
+                    Helpers::TraceCommand(job.arguments, command, name);
+                Helpers::RecordTrace(job.category, job.name ? job.name : name.data(), command.data(), startTime, job.exitCode);
+            }
+
+            if (job.exitCode == 0 && job.stampFile)
+            {
+                if (FILE* f = Helpers::OpenFile(job.stampFile, "wb"))
+                {
+                    fwrite(job.stampContent, 1, Length(job.stampContent), f);
+                    fclose(f);
+                }
+                Helpers::InvalidatePath(job.stampFile);
+            }
+
+            if (job.onExit && !skip)
+                job.onExit(job.onExitArguments, job.exitCode);
+
+            if (job.exitCode != 0)
+            {
+                __atomic_store_n(&state.success, false, __ATOMIC_RELAXED);
+                if (!state.keepGoing)
+                    __atomic_store_n(&state.stop, true, __ATOMIC_RELAXED);
+            }
+
+            // Dependents of a failed job are still queued, so that they get skipped and counted the same way as any other job.
+            for (JobId dependent : job.dependents)
+            {
+                if (job.exitCode != 0)
+                    __atomic_store_n(&state.jobs[dependent].dependencyFailed, true, __ATOMIC_RELEASE);
+                if (__atomic_sub_fetch(&state.jobs[dependent].dependencies, 1, __ATOMIC_ACQ_REL) == 0)
+                    state.push(self, dependent);
+            }
+
+            __atomic_sub_fetch(&state.remaining, 1, __ATOMIC_SEQ_CST);
+            __atomic_sub_fetch(&state.busy, 1, __ATOMIC_SEQ_CST);
+
+            LockMutex(state.mutex);
+            UnlockMutex(state.mutex);
+            WakeAll(state.wakeUp);
+        }
+    };
+
+    Array<WorkQueue> queues;
+    queues.reserve(workerCount);
+    for (size_t i = 0; i < workerCount; i++)
+        queues.push({ {}, static_cast<JobId*>(malloc(mJobs.size() * sizeof(JobId))) });
+
+    RunState state = { mJobs, queues.data(), workerCount, keepGoing };
+    state.remaining = mJobs.size();
+
+    // The pending dependency counters are consumed while running, save them to run the same jobs again.
+    Array<size_t> dependencies;
+    for (size_t i = 0, nextQueue = 0; i < mJobs.size(); i++)
+    {
+        mJobs[i].exitCode = SkippedExitCode;
+        mJobs[i].dependencyFailed = false;
+        dependencies.push(mJobs[i].dependencies);
+        if (mJobs[i].dependencies == 0)
+            state.push(nextQueue++ % workerCount, i);
+    }
+
+    // The calling thread is a worker too.
+    Array<Worker> workers;
+    for (size_t i = 0; i < workerCount; i++)
+        workers.push({ &state, i });
+
+    Array<ThreadHandle> threads;
+    for (size_t i = 1; i < workerCount; i++)
+        threads.push(StartThread(Work, &workers[i]));
+    Work(&workers[0]);
+    for (ThreadHandle thread : threads)
+        JoinThread(thread);
+
+    for (size_t i = 0; i < mJobs.size(); i++)
+        mJobs[i].dependencies = dependencies[i];
+    for (WorkQueue& queue : queues)
+        free(queue.jobs);
+
+    return state.success;
+}
+
+
+
+inline void TraumaBuildSystem::Helpers::AppendOutput(ProcessData& data, const char* const buffer, size_t size)
+{
+    if (data.outputSize + size + 1 > data.outputCapacity)
+    {
+        size_t capacity = data.outputCapacity < 4096 ? 4096 : data.outputCapacity;
+        while (data.outputSize + size + 1 > capacity)
+            capacity *= 2;
+
+        auto output = static_cast<char*>(realloc(data.output, capacity));
+        if (!output)
+            return;
+        data.output = output;
+        data.outputCapacity = capacity;
+    }
+
+    memcpy(data.output + data.outputSize, buffer, size);
+    data.outputSize += size;
+    data.output[data.outputSize] = '\0';
+}
+
+
+
+#ifdef __linux__
+inline void TraumaBuildSystem::Helpers::PollProcesses(bool block)
+{
+    using namespace TraumaBuildSystem::Platform;
+    ProcessRegistry& registry = gProcessRegistry;
+
+    if (block)
+    {
+        Array<pollfd> fds;
+        fds.push({ registry.wakeFd, POLLIN, 0 });
+
+        // Without a pidfd the only way to notice an exit is to check periodically.
+        int timeout = -1;
+        for (ProcessData* data = registry.first; data; data = data->next)
+        {
+            if (data->outputFd != -1)
+                fds.push({ data->outputFd, POLLIN, 0 });
+            if (!data->exited && data->pidFd != -1)
+                fds.push({ data->pidFd, POLLIN, 0 });
+            if (!data->exited && data->pidFd == -1)
+                timeout = 10;
+        }
+
+        // Other threads may spawn, drain or reap in the meantime: descriptors closed by them just make poll() return early.
+        UnlockMutex(registry.mutex);
+        poll(fds.data(), fds.size(), timeout);
+        LockMutex(registry.mutex);
+
+        uint64 wakeUps;
+        while (read(registry.wakeFd, &wakeUps, sizeof(wakeUps)) > 0);
+    }
+
+    for (ProcessData* data = registry.first; data; data = data->next)
+    {
+        char buffer[16 * 1024];
+        while (data->outputFd != -1)
+        {
+            ssize_t bytesRead = read(data->outputFd, buffer, sizeof(buffer));
+            if (bytesRead > 0)
+                AppendOutput(*data, buffer, static_cast<size_t>(bytesRead));
+            else if (bytesRead == -1 && errno == EINTR)
+                continue;
+            else
+            {
+                if (bytesRead == 0 || errno != EAGAIN)
+                {
+                    close(data->outputFd);
+                    data->outputFd = -1;
+                }
+                break;
+            }
+        }
+
+        int status = 0;
+        if (!data->exited && waitpid(data->pid, &status, WNOHANG) == data->pid)
+        {
+            data->exited = true;
+            data->exitCode = WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+            if (data->pidFd != -1)
+            {
+                close(data->pidFd);
+                data->pidFd = -1;
+            }
+        }
+    }
+}
+#endif
+
+
+
+inline bool TraumaBuildSystem::Helpers::IsFinished(ProcessData& data)
+{
+    #ifdef _WIN32
+        if (!data.exited && Windows::WaitForSingleObject(data.process, 0) == WAIT_OBJECT_0)
+        {
+            // The reader stops once every copy of the pipe's write end is closed, which usually happens together with the exit.
+            if (data.reader)
+            {
+                Platform::JoinThread(data.reader);
+                data.reader = nullptr;
+            }
+
+            Windows::DWORD exitCode = 0;
+            Windows::GetExitCodeProcess(data.process, &exitCode);
+            data.exitCode = static_cast<int>(exitCode);
+            data.exited = true;
+        }
+        return data.exited;
+    #elif defined(__linux__)
+        return data.exited && data.outputFd == -1;
+    #endif
+}
+
+
+
+inline void TraumaBuildSystem::Helpers::WaitProcesses(ProcessData** processes, size_t count, bool block)
+{
+    #ifdef _WIN32
+        if (!block)
+            return;
+
+        // WaitForMultipleObjects() is limited to 64 handles, larger sets are checked in rounds.
+        Windows::HANDLE handles[64];
+        Windows::DWORD handleCount = 0;
+        for (size_t i = 0; i < count && handleCount < 64; i++)
+            if (!processes[i]->exited)
+                handles[handleCount++] = processes[i]->process;
+
+        if (handleCount > 0)
+            Windows::WaitForMultipleObjects(handleCount, handles, FALSE, count > 64 ? 10 : INFINITE);
+    #elif defined(__linux__)
+        // The caller checks for finished processes, here it's enough to make progress on all of them.
+        (void)processes;
+        (void)count;
+        PollProcesses(block);
+    #endif
+}
+
+
+
+inline TraumaBuildSystem::v1::Experimental::Process::~Process()
+{
+    if (!mData)
+        return;
+
+    if (!mData->waited)
+        Wait(*this);
+
+    #ifdef _WIN32
+        if (mData->process)
+            Windows::CloseHandle(mData->process);
+        if (mData->outputPipe)
+            Windows::CloseHandle(mData->outputPipe);
+    #elif defined(__linux__)
+        Platform::LockMutex(Helpers::gProcessRegistry.mutex);
+        for (Helpers::ProcessData** p = &Helpers::gProcessRegistry.first; *p; p = &(*p)->next)
+            if (*p == mData)
+            {
+                *p = mData->next;
+                break;
+            }
+        Platform::UnlockMutex(Helpers::gProcessRegistry.mutex);
+    #endif
+
+    Helpers::DeleteResponseFile(mData->responseFile);
+    free(mData->output);
+    free(mData);
+}
+
+
+
+inline TraumaBuildSystem::v1::Experimental::Process& TraumaBuildSystem::v1::Experimental::Process::operator=(Process&& other)
+{
+    if (this != &other)
+    {
+        this->~Process();
+        mData = other.mData;
+        other.mData = nullptr;
+    }
+    return *this;
+}
+
+
+
+inline TraumaBuildSystem::v1::Experimental::Process TraumaBuildSystem::v1::Experimental::Spawn(const auto& cmd, bool captureOutput)
+{
+    static_assert(TypeTraits::IsStringLiteral<decltype(cmd)> || TypeTraits::IsString<decltype(cmd)> || TypeTraits::IsSmallString<decltype(cmd)> || TypeTraits::IsCommandLine<decltype(cmd)>);
+
+    auto data = static_cast<Helpers::ProcessData*>(calloc(1, sizeof(Helpers::ProcessData)));
+    data->exitCode = -1;
+
+    #ifdef _WIN32
+        Windows::HANDLE writePipe = nullptr;
+        Windows::STARTUPINFOEXW startupInfo = {};
+        startupInfo.StartupInfo.cb = sizeof(startupInfo);
+        Windows::LPPROC_THREAD_ATTRIBUTE_LIST attributes = nullptr;
+        Windows::DWORD creationFlags = 0;
+
+        if (captureOutput)
+        {
+            Windows::SECURITY_ATTRIBUTES security = { sizeof(security), nullptr, TRUE };
+            if (!Windows::CreatePipe(&data->outputPipe, &writePipe, &security, 0))
+            {
+                data->exited = true;
+                return Process(data);
+            }
+            Windows::SetHandleInformation(data->outputPipe, HANDLE_FLAG_INHERIT, 0);
+
+            // Only the write end must reach the child: processes spawned concurrently would otherwise inherit it too,
+            // keeping the pipe open after this child exits.
+            Windows::SIZE_T attributesSize = 0;
+            Windows::InitializeProcThreadAttributeList(nullptr, 1, 0, &attributesSize);
+            attributes = static_cast<Windows::LPPROC_THREAD_ATTRIBUTE_LIST>(malloc(attributesSize));
+            Windows::InitializeProcThreadAttributeList(attributes, 1, 0, &attributesSize);
+            Windows::UpdateProcThreadAttribute(attributes, 0, 0x20002 /* PROC_THREAD_ATTRIBUTE_HANDLE_LIST */, &writePipe, sizeof(writePipe), nullptr, nullptr);
+
+            startupInfo.StartupInfo.dwFlags = STARTF_USESTDHANDLES;
+            startupInfo.StartupInfo.hStdOutput = writePipe;
+            startupInfo.StartupInfo.hStdError = writePipe;
+            startupInfo.lpAttributeList = attributes;
+            creationFlags = EXTENDED_STARTUPINFO_PRESENT;
+        }
+
+        Windows::PROCESS_INFORMATION processInfo = {};
+        Array<char> commandString;
+        Helpers::ToCommandString(cmd, commandString, data->responseFile);
+        auto wStrCmd = Helpers::ToWStr(commandString.data());
+        Windows::LPWSTR wStrDirectory = Helpers::gThreadContext.directory.is_empty() ? nullptr : Helpers::ToWStr(Helpers::ToWinPath(Helpers::gThreadContext.directory));
+        Windows::LPWSTR environment = Helpers::ToEnvironmentBlock();
+        bool started = Windows::CreateProcessW(nullptr, wStrCmd, nullptr, nullptr, captureOutput, creationFlags | CREATE_UNICODE_ENVIRONMENT, environment, wStrDirectory, &startupInfo.StartupInfo, &processInfo);
+        free(wStrCmd);
+        free(wStrDirectory);
+        free(environment);
+
+        if (attributes)
+        {
+            Windows::DeleteProcThreadAttributeList(attributes);
+            free(attributes);
+        }
+        if (writePipe)
+            Windows::CloseHandle(writePipe);
+
+        if (!started)
+        {
+            data->exited = true;
+            return Process(data);
+        }
+
+        Windows::CloseHandle(processInfo.hThread);
+        data->process = processInfo.hProcess;
+
+        if (captureOutput)
+            data->reader = Platform::StartThread([] (void* dataPtr)
+            {
+                auto& data = *static_cast<Helpers::ProcessData*>(dataPtr);
+                char buffer[16 * 1024];
+                Windows::DWORD bytesRead = 0;
+                while (Windows::ReadFile(data.outputPipe, buffer, sizeof(buffer), &bytesRead, nullptr) && bytesRead > 0)
+                    Helpers::AppendOutput(data, buffer, bytesRead);
+            }, data);
+    #elif defined(__linux__)
+        using namespace TraumaBuildSystem::Platform;
+        Helpers::ProcessRegistry& registry = Helpers::gProcessRegistry;
+
+        data->outputFd = -1;
+        data->pidFd = -1;
+
+        int pipeFds[2] = { -1, -1 };
+        if (captureOutput && pipe2(pipeFds, O_CLOEXEC) == -1)
+        {
+            data->exited = true;
+            return Process(data);
+        }
+
+        data->pid = Helpers::SpawnProcess(cmd, pipeFds[1], data->responseFile);
+        if (captureOutput)
+        {
+            close(pipeFds[1]);
+            if (data->pid != -1)
+            {
+                fcntl(pipeFds[0], F_SETFL, O_NONBLOCK);
+                data->outputFd = pipeFds[0];
+            }
+            else
+                close(pipeFds[0]);
+        }
+
+        if (data->pid == -1)
+        {
+            data->exited = true;
+            return Process(data);
+        }
+
+        #ifdef SYS_pidfd_open
+            data->pidFd = static_cast<int>(syscall(SYS_pidfd_open, data->pid, 0));
+        #endif
+
+        LockMutex(registry.mutex);
+        if (registry.wakeFd == -1)
+            registry.wakeFd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+        data->next = registry.first;
+        registry.first = data;
+        UnlockMutex(registry.mutex);
+
+        // Threads already waiting must add this process to their poll set.
+        uint64 wakeUp = 1;
+        [[maybe_unused]] ssize_t written = write(registry.wakeFd, &wakeUp, sizeof(wakeUp));
+    #endif
+
+    return Process(data);
+}
+
+
+
+inline int TraumaBuildSystem::v1::Experimental::Wait(Process& process)
+{
+    Process* processes = &process;
+    if (process.is_valid() && !process.handle()->waited)
+        WaitAny(processes, 1);
+
+    return process.is_valid() ? process.handle()->exitCode : -1;
+}
+
+
+
+inline bool TraumaBuildSystem::v1::Experimental::TryWait(Process& process, int& exitCode)
+{
+    if (!process.is_valid())
+        return false;
+
+    Helpers::ProcessData* data = process.handle();
+
+    #ifdef __linux__
+        Platform::LockMutex(Helpers::gProcessRegistry.mutex);
+        Helpers::PollProcesses(false);
+    #endif
+
+    bool finished = Helpers::IsFinished(*data);
+
+    #ifdef __linux__
+        Platform::UnlockMutex(Helpers::gProcessRegistry.mutex);
+    #endif
+
+    if (finished)
+    {
+        data->waited = true;
+        exitCode = data->exitCode;
+        InvalidateFileSystemCache();
+    }
+    return finished;
+}
+
+
+
+inline size_t TraumaBuildSystem::v1::Experimental::WaitAny(Process* processes, size_t count)
+{
+    Array<Helpers::ProcessData*> pending;
+    Array<size_t> indices;
+    for (size_t i = 0; i < count; i++)
+        if (processes[i].is_valid() && !processes[i].handle()->waited)
+        {
+            pending.push(processes[i].handle());
+            indices.push(i);
+        }
+
+    if (pending.is_empty())
+        return count;
+
+    #ifdef __linux__
+        Platform::LockMutex(Helpers::gProcessRegistry.mutex);
+    #endif
+
+    size_t finished = count;
+    for (bool block = false; finished == count; block = true)
+    {
+        Helpers::WaitProcesses(pending.data(), pending.size(), block);
+        for (size_t i = 0; i < pending.size() && finished == count; i++)
+            if (Helpers::IsFinished(*pending[i]))
+            {
+                pending[i]->waited = true;
+                finished = indices[i];
+            }
+    }
+
+    #ifdef __linux__
+        Platform::UnlockMutex(Helpers::gProcessRegistry.mutex);
+    #endif
+
+    InvalidateFileSystemCache();
+    return finished;
+}
+
+
+
+inline TraumaBuildSystem::Helpers::ThreadContext::~ThreadContext()
+{
+    #ifdef __linux__
+        if (directoryFd != AT_FDCWD)
+            close(directoryFd);
+    #endif
+}
+
+
+
+inline TraumaBuildSystem::SmallString TraumaBuildSystem::Helpers::ToThreadPath(const char* const path)
+{
+    #ifdef _WIN32
+        bool absolute = path[0] == '/' || path[0] == '\\' || (path[0] != '\0' && path[1] == ':');
+    #else
+        bool absolute = path[0] == '/';
+    #endif
+    if (absolute || gThreadContext.directory.is_empty())
+        return SmallString(path);
+    return gThreadContext.directory / path;
+}
+
+
+
+inline FILE* TraumaBuildSystem::Helpers::OpenFile(const char* const filename, const char* const mode)
+{
+    #ifdef _WIN32
+        return fopen(ToThreadPath(filename), mode);
+    #elif defined(__linux__)
+        int flags = O_CLOEXEC;
+        bool update = strchr(mode, '+') != nullptr;
+        if (mode[0] == 'r')
+            flags |= update ? O_RDWR : O_RDONLY;
+        else if (mode[0] == 'w')
+            flags |= (update ? O_RDWR : O_WRONLY) | O_CREAT | O_TRUNC;
+        else if (mode[0] == 'a')
+            flags |= (update ? O_RDWR : O_WRONLY) | O_CREAT | O_APPEND;
+        else
+            return nullptr;
+
+        int fd = openat(gThreadContext.directoryFd, filename, flags, 0666);
+        FILE* f = fd != -1 ? fdopen(fd, mode) : nullptr;
+        if (fd != -1 && !f)
+            close(fd);
+        return f;
+    #endif
+}
+
+
+
+#ifdef _WIN32
+    inline TraumaBuildSystem::SmallString TraumaBuildSystem::Helpers::ToShellCommand(const char* const cmd)
+    {
+        if (gThreadContext.directory.is_empty())
+            return SmallString(cmd);
+
+        SmallString shellCommand("cd /d \"");
+        shellCommand += ToWinPath(gThreadContext.directory);
+        shellCommand.append("\" && ");
+        shellCommand.append(cmd);
+        return shellCommand;
+    }
+
+
+
+    inline Windows::LPWSTR TraumaBuildSystem::Helpers::ToEnvironmentBlock()
+    {
+        if (gThreadContext.environment.is_empty())
+            return nullptr;
+
+        // NAME=value strings one after the other, each one null terminated, with an empty one at the end.
+        Array<char> block;
+        auto NameLength = [] (const char* variable) { const char* end = strchr(variable + 1, '='); return end ? static_cast<size_t>(end - variable) : strlen(variable); };
+        for (char** variable = _environ; *variable; variable++)
+        {
+            bool changed = false;
+            for (const SmallString& change : gThreadContext.environment)
+                changed = changed || (NameLength(change) == NameLength(*variable) && _strnicmp(change, *variable, NameLength(change)) == 0);
+            if (!changed)
+                block.append(*variable, strlen(*variable) + 1);
+        }
+        for (const SmallString& change : gThreadContext.environment)
+            if (strchr(change, '='))
+                block.append(change, change.length() + 1);
+        block.push('\0');
+
+        int wLength = Windows::MultiByteToWideChar(CP_UTF8, 0, block.data(), static_cast<int>(block.size()), nullptr, 0);
+        auto wStr = static_cast<Windows::LPWSTR>(malloc(static_cast<size_t>(wLength) * sizeof(wchar_t)));
+        Windows::MultiByteToWideChar(CP_UTF8, 0, block.data(), static_cast<int>(block.size()), wStr, wLength);
+        return wStr;
+    }
+#endif
+
+
+
+inline bool TraumaBuildSystem::Helpers::GetFileStamp(const char* const filename, FileStamp& stamp)
+{
+    #ifdef _WIN32
+        auto wStr = ToWStr(ToWinPath(ToThreadPath(filename)));
+        Windows::WIN32_FILE_ATTRIBUTE_DATA fileData = {};
+        bool success = Windows::GetFileAttributesExW(wStr, Windows::GetFileExInfoStandard, &fileData);
+        free(wStr);
+        if (!success)
+            return false;
+
+        stamp.size = (static_cast<uint64>(fileData.nFileSizeHigh) << 32) | fileData.nFileSizeLow;
+        stamp.time = (static_cast<uint64>(fileData.ftLastWriteTime.dwHighDateTime) << 32) | fileData.ftLastWriteTime.dwLowDateTime;
+        stamp.inode = 0;
+    #elif defined(__linux__)
+        struct stat fileStat;
+        if (fstatat(gThreadContext.directoryFd, filename, &fileStat, 0) != 0)
+            return false;
+
+        stamp.size = static_cast<uint64>(fileStat.st_size);
+        stamp.time = static_cast<uint64>(fileStat.st_mtim.tv_sec) * 1000000000ull + static_cast<uint64>(fileStat.st_mtim.tv_nsec);
+        stamp.inode = static_cast<uint64>(fileStat.st_ino);
+    #endif
+
+    return true;
+}
+
+
+
+inline uint64 TraumaBuildSystem::Helpers::CurrentFileTime()
+{
+    #ifdef _WIN32
+        Windows::FILETIME time;
+        Windows::GetSystemTimeAsFileTime(&time);
+        return (static_cast<uint64>(time.dwHighDateTime) << 32) | time.dwLowDateTime;
+    #elif defined(__linux__)
+        timespec time;
+        clock_gettime(CLOCK_REALTIME, &time);
+        return static_cast<uint64>(time.tv_sec) * 1000000000ull + static_cast<uint64>(time.tv_nsec);
+    #endif
+}
+
+
+
+inline uint64 TraumaBuildSystem::Helpers::MonotonicTime()
 {
-    // TODO
-    return false;
+    #ifdef _WIN32
+        Windows::LARGE_INTEGER counter, frequency;
+        Windows::QueryPerformanceCounter(&counter);
+        Windows::QueryPerformanceFrequency(&frequency);
+        return static_cast<uint64>(static_cast<double>(counter.QuadPart) * 1e9 / static_cast<double>(frequency.QuadPart));
+    #elif defined(__linux__)
+        timespec time;
+        clock_gettime(CLOCK_MONOTONIC, &time);
+        return static_cast<uint64>(time.tv_sec) * 1000000000ull + static_cast<uint64>(time.tv_nsec);
+    #endif
 }
 
 
 
-inline constexpr bool TraumaBuildSystem::v1::Experimental::IsRelativePath([[maybe_unused]] const auto& path)
+inline void TraumaBuildSystem::Helpers::TraceCommand(const auto& cmd, Array<char>& command, Array<char>& name)
 {
-    // TODO
-    return false;
+    if constexpr (TypeTraits::IsCommandLine<decltype(cmd)>)
+    {
+        cmd.join(command);
+        const char* program = cmd.is_empty() ? "" : cmd[0];
+        name.append(program, Length(program) + 1);
+    }
+    else
+    {
+        const char* line = ToCStr(cmd);
+        command.append(line, Length(line) + 1);
+
+        const char* end = line;
+        while (*end != '\0' && !IsBlank(*end))
+            end++;
+        name.append(line, static_cast<size_t>(end - line));
+        name.push('\0');
+    }
 }
 
 
 
-inline bool TraumaBuildSystem::v1::Experimental::CreateDirectory(const auto& path)
+inline void TraumaBuildSystem::Helpers::RecordTrace(const char* const category, const char* const name, const char* const command, uint64 startTime, int exitCode)
 {
-    static_assert(TypeTraits::IsStringLiteral<decltype(path)> || TypeTraits::IsString<decltype(path)>);
-    if (!IsValidPath(path)) return false;
+    TraceLog* trace = gTrace;
+    if (!trace)
+        return;
 
-    #ifdef _WIN32
-        auto RecursiveDirectoryCreation = [] (auto winPath, auto RecursiveDirectoryCreation) -> bool
+    uint64 endTime = MonotonicTime();
+    auto AppendJsonString = [] (Array<char>& json, const char* p)
+    {
+        json.push('\"');
+        for (; *p != '\0'; p++)
         {
-            if (size_t index = FindLastOf(winPath, "\\");
-                index != InvalidStringIndex)
+            if (*p == '\"' || *p == '\\')
             {
-                index++;
-                auto rootDirectory = static_cast<char*>(malloc(index));
-                memcpy(rootDirectory, winPath, index);
-                rootDirectory[index - 1] = '\0';
-                RecursiveDirectoryCreation(rootDirectory, RecursiveDirectoryCreation);
-                free(rootDirectory);
+                json.push('\\');
+                json.push(*p);
             }
+            else if (static_cast<unsigned char>(*p) < 0x20)
+            {
+                char escape[8];
+                snprintf(escape, sizeof(escape), "\\u%04x", static_cast<unsigned>(*p));
+                json.append(escape, 6);
+            }
+            else
+                json.push(*p);
+        }
+        json.push('\"');
+    };
 
-            auto wStr = Helpers::ToWStr(winPath);
-            Windows::BOOL success = Windows::CreateDirectoryW(wStr, nullptr);
-            free(wStr);
-
-            // TODO: Detailed error reporting.
-            return success;
-        };
-
-        auto winPath = Helpers::ToWinPath(path);
-        return RecursiveDirectoryCreation(winPath, RecursiveDirectoryCreation);
-    #endif
+    // The event is formatted outside of the lock, only appending it is serialized.
+    Array<char> event;
+    char number[128];
+    event.append("{\"name\":", 8);
+    AppendJsonString(event, name);
+    event.append(",\"cat\":", 7);
+    AppendJsonString(event, category);
+
+    Platform::LockMutex(trace->mutex);
+    uint64 origin = trace->startTime;
+    Platform::UnlockMutex(trace->mutex);
+    startTime = startTime > origin ? startTime - origin : 0;
+    endTime = endTime > origin ? endTime - origin : 0;
+
+    // Trace-event times are in microseconds.
+    int numberLength = snprintf(number, sizeof(number), ",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":1,\"tid\":%zu,\"args\":{\"slot\":%zu,\"exitCode\":%d,\"command\":",
+        static_cast<double>(startTime) / 1000.0, static_cast<double>(endTime - startTime) / 1000.0, gTraceSlot, gTraceSlot, exitCode);
+    event.append(number, static_cast<size_t>(numberLength));
+    AppendJsonString(event, command);
+    event.append("}},\n", 4);
+
+    Platform::LockMutex(trace->mutex);
+    trace->events.append(event.data(), event.size());
+    if (gTraceSlot >= trace->slotCount)
+        trace->slotCount = gTraceSlot + 1;
+    Platform::UnlockMutex(trace->mutex);
 }
 
 
 
-inline bool TraumaBuildSystem::v1::Experimental::DeleteDirectory(const auto& path)
+inline void TraumaBuildSystem::Helpers::RecordDependencies(const char* const dependencyFile, const char* const input)
 {
-    static_assert(TypeTraits::IsStringLiteral<decltype(path)> || TypeTraits::IsString<decltype(path)>);
+    DependencyLog* log = gDependencies;
+    if (!log)
+        return;
 
-    #ifdef _WIN32
-        auto winPath = Helpers::ToWinPath(path + "\0");
-        auto wStr = Helpers::ToWStr(winPath);
-        Windows::SHFILEOPSTRUCTW op = {};
-        op.wFunc = FO_DELETE;
-        op.pFrom = wStr;
-        op.fFlags = FOF_NOCONFIRMATION | FOF_NOERRORUI | FOF_SILENT;
-        Windows::SHFileOperationW(&op);
-        free(wStr);
-        return !op.fAnyOperationsAborted;
-    #endif
+    Platform::LockMutex(log->mutex);
+    if (dependencyFile)
+        log->dependencyFiles.push(SmallString(dependencyFile));
+    if (input)
+        log->inputs.push(SmallString(input));
+    Platform::UnlockMutex(log->mutex);
 }
 
 
 
-inline auto TraumaBuildSystem::v1::Experimental::CurrentWorkingDirectory()
+inline TraumaBuildSystem::SmallString TraumaBuildSystem::Helpers::ObjectCachePath(uint64 key, const char* const extension)
 {
-    #ifdef _WIN32
-        Windows::DWORD wStrBufferCharLength = Windows::GetCurrentDirectoryW(0, nullptr);
-        auto wStr = static_cast<Windows::LPWSTR>(malloc(static_cast<size_t>(wStrBufferCharLength) * sizeof(wchar_t)));
-        Windows::GetCurrentDirectoryW(wStrBufferCharLength, wStr);
-        String<4096> currentDir = Helpers::ToCStr(wStr);
-        free(wStr);
-        return Helpers::ToProperPath(currentDir);
-    #endif
+    auto name = ToHexString(key);
+    SmallString path = gObjectCache.directory;
+    path.push('/');
+    path.append(name, 2);
+    path.push('/');
+    path.append(name, name.length());
+    path.append(extension);
+    return path;
 }
 
 
 
-inline bool TraumaBuildSystem::v1::Experimental::CurrentWorkingDirectory(const auto& path)
+inline bool TraumaBuildSystem::Helpers::ObjectKey(uint64 baseKey, const char* const dependencies, uint64& key)
 {
-    static_assert(TypeTraits::IsStringLiteral<decltype(path)> || TypeTraits::IsString<decltype(path)>);
-
-    #ifdef _WIN32
-        Windows::LPWSTR wStr = Helpers::ToWStr(Helpers::ToWinPath(path));
-        bool success = Windows::SetCurrentDirectoryW(wStr);
-        free(wStr);
-        return success;
-    #endif
+    // Paths are hashed along with the content: the same headers found in other places make a different object.
+    bool complete = true;
+    key = baseKey;
+    ForEachDependency(dependencies, [&] (const SmallString& dependency)
+    {
+        uint64 fingerprint = v1::Experimental::Fingerprint(dependency);
+        key = Hash(dependency.c_str(), dependency.length() + 1, key);
+        key = Hash(reinterpret_cast<const char*>(&fingerprint), sizeof(fingerprint), key);
+        complete = fingerprint != 0;
+        return complete;
+    });
+    return complete;
 }
 
 
 
-inline void TraumaBuildSystem::v1::Experimental::ForEachFile(const auto& path, auto&& fn)
+inline bool TraumaBuildSystem::Helpers::RestoreObject(uint64 baseKey, const char* const object, const char* const dependencyFile, const char* const outputFile)
 {
-    static_assert(TypeTraits::IsStringLiteral<decltype(path)> || TypeTraits::IsString<decltype(path)>);
-    // TODO: Strengthen fn static checks.
+    using namespace v1::Experimental;
 
-    #ifdef _WIN32
-        auto winPath = Helpers::ToWinPath(path);
-        auto wStr = Helpers::ToWStr(winPath);
-        Windows::WIN32_FIND_DATAW fileData = {};
-        Windows::HANDLE handle = Windows::FindFirstFileW(wStr, &fileData);
-        free(wStr);
-        do { fn(Helpers::ToCStr(fileData.cFileName)); } while (Windows::FindNextFileW(handle, &fileData));
-        Windows::FindClose(handle);
-    #endif
+    SmallString manifestFile = ObjectCachePath(baseKey, ".d");
+    auto [manifest, manifestSize] = ReadFile(manifestFile);
+    if (!manifest)
+        return false;
+
+    uint64 key = 0;
+    bool found = ObjectKey(baseKey, manifest, key);
+    free(manifest);
+
+    // The object goes last: until it's in place, the next run sees no previous output and tries again.
+    found = found && CopyFile(ObjectCachePath(key, ".log"), outputFile) && CopyFile(manifestFile, dependencyFile);
+    return found && CopyFile(ObjectCachePath(key, ".o"), object);
 }
 
 
 
-inline bool TraumaBuildSystem::v1::Experimental::DeleteFile(const auto& filename)
+inline void TraumaBuildSystem::Helpers::StoreObject(const v1::Experimental::CommandLine& arguments, int exitCode)
 {
-    static_assert(TypeTraits::IsStringLiteral<decltype(filename)> || TypeTraits::IsString<decltype(filename)>);
+    using namespace v1::Experimental;
 
-    if (!IsValidPath(filename) || NotExists(filename)) return false;
+    // Failed compiles aren't cached, their diagnostics are printed again on the next attempt anyway.
+    if (exitCode != 0 || arguments.size() != 4)
+        return;
 
-    #ifdef _WIN32
-        auto winFilename = Helpers::ToWinPath(filename);
-        auto wStr = Helpers::ToWStr(winFilename);
-        bool success = Windows::DeleteFileW(wStr);
-        free(wStr);
-        return success;
-    #endif
-}
+    const char* dependencyFile = arguments[1];
+    const char* object = arguments[2];
+    const char* outputFile = arguments[3];
+    uint64 baseKey = strtoull(arguments[0], nullptr, 16);
 
+    auto [dependencies, dependenciesSize] = ReadFile(dependencyFile);
+    if (!dependencies)
+        return;
 
+    uint64 key = 0;
+    bool complete = ObjectKey(baseKey, dependencies, key);
+    free(dependencies);
+    if (!complete)
+        return;
 
-inline bool TraumaBuildSystem::v1::Experimental::CopyFile(const auto& fromPath, const auto& toPath)
-{
-    static_assert(TypeTraits::IsStringLiteral<decltype(fromPath)> || TypeTraits::IsString<decltype(fromPath)>);
-    static_assert(TypeTraits::IsStringLiteral<decltype(toPath)> || TypeTraits::IsString<decltype(toPath)>);
+    // The manifest goes last, so that it never points to objects that aren't there yet.
+    SmallString directory = StripFileName(ObjectCachePath(key, ""));
+    if (NotExists(directory))
+        CreateDirectory(directory);
+    directory = StripFileName(ObjectCachePath(baseKey, ""));
+    if (NotExists(directory))
+        CreateDirectory(directory);
+
+    if (StoreCacheFile(object, ObjectCachePath(key, ".o")) && StoreCacheFile(outputFile, ObjectCachePath(key, ".log")))
+        StoreCacheFile(dependencyFile, ObjectCachePath(baseKey, ".d"));
+}
 
-    if (!IsValidPath(fromPath) || !IsValidPath(toPath)) return false;
 
-    // TODO: If toPath doesn't exist, create.
 
+inline bool TraumaBuildSystem::Helpers::StoreCacheFile(const char* const filename, const char* const cacheFilename)
+{
+    // Unique among the workers of every process sharing the cache.
     #ifdef _WIN32
-        auto winFrom = Helpers::ToWinPath(fromPath);
-        auto wStrFrom = Helpers::ToWStr(winFrom);
+        uint64 unique[3] = { MonotonicTime(), gTraceSlot, Windows::GetCurrentProcessId() };
+    #elif defined(__linux__)
+        uint64 unique[3] = { MonotonicTime(), gTraceSlot, static_cast<uint64>(getpid()) };
+    #endif
+    SmallString temporaryFile(cacheFilename);
+    temporaryFile.append(".tmp");
+    temporaryFile.append(ToHexString(Hash(reinterpret_cast<const char*>(unique), sizeof(unique))));
 
-        auto winTo = Helpers::ToWinPath(toPath);
-        auto wStrTo = Helpers::ToWStr(winTo);
+    if (!v1::Experimental::CopyFile(filename, temporaryFile))
+    {
+        v1::Experimental::DeleteFile(temporaryFile);
+        return false;
+    }
 
-        bool success = Windows::CopyFileW(wStrFrom, wStrTo, FALSE);
-        free(wStrFrom);
-        free(wStrTo);
-        return success;
+    // On Windows rename() doesn't replace an existing file, which can only be an entry with the same key stored by another build.
+    #ifdef _WIN32
+        bool success = rename(ToThreadPath(temporaryFile), ToThreadPath(cacheFilename)) == 0;
+        if (!success)
+            remove(ToThreadPath(temporaryFile));
+    #elif defined(__linux__)
+        bool success = renameat(gThreadContext.directoryFd, temporaryFile, gThreadContext.directoryFd, cacheFilename) == 0;
+        if (!success)
+            unlinkat(gThreadContext.directoryFd, temporaryFile, 0);
     #endif
+    InvalidatePath(cacheFilename);
+    return success || v1::Experimental::Exists(cacheFilename);
 }
 
 
 
-inline TraumaBuildSystem::FileData TraumaBuildSystem::v1::Experimental::ReadFile(const auto& filename)
+inline TraumaBuildSystem::v1::Experimental::JobId TraumaBuildSystem::Helpers::CompileObject(v1::Experimental::Scheduler& scheduler, const auto& sourceFile, const auto& objectBase, const auto& compilerFlags, const auto& includes, bool& queued)
 {
-    FILE* f = fopen(filename, "rb");
-    if (!f)
-        return { nullptr, 0 };
+    using namespace v1::Experimental;
 
-    fseek(f, 0, SEEK_END);
-    size_t fileSize = static_cast<size_t>(ftell(f));
-    fseek(f, 0, SEEK_SET);
+    auto sourceOutput = StrCat(objectBase, ".o");
+    auto dependencyFile = StrCat(objectBase, ".d");
+    auto commandFile = StrCat(objectBase, ".cmd");
+    queued = false;
+    RecordDependencies(ToCStr(dependencyFile), nullptr);
 
-    auto buffer = static_cast<char*>(malloc(fileSize + 1));
-    if (!buffer)
-        return { nullptr, fileSize };
+    // The dependency file options are the same on every run, so they can be part of the recorded command line too.
+    CommandLine cmd("g++");
+    cmd.add("-c").add_split(compilerFlags).add_split(includes).add("-MMD").add("-MF").add(dependencyFile).add("-o").add(sourceOutput).add(sourceFile);
+    auto commandHash = ToHexString(Hash(cmd.data(), cmd.length()));
 
-    fread(buffer, 1, fileSize, f);
-    fclose(f);
-    buffer[fileSize] = '\0';
+    SmallString reason;
+    if (IsUpToDate(sourceOutput, dependencyFile, commandFile, commandHash, reason))
+        return scheduler.add("");
 
-    return { buffer, fileSize };
-}
+    // A restored object is new as well, whatever is built from it must be updated.
+    queued = true;
 
+    // The hash is only recorded once the object is complete, so a failed compile is retried on the next run.
+    DeleteFile(commandFile);
+    if (!gObjectCache.enabled)
+    {
+        printf("Building %s... (%s)\n", ToCStr(sourceFile), reason.c_str());
+        JobId job = scheduler.add(cmd, commandFile, commandHash);
+        scheduler.describe(job, "Compile", sourceFile);
+        return job;
+    }
 
+    // The output file names are part of the command, so objects built in different places don't share cache entries.
+    auto outputFile = StrCat(objectBase, ".log");
+    uint64 baseKey = Hash(cmd.data(), cmd.length(), gObjectCache.compilerKey);
+    uint64 sourceFingerprint = Fingerprint(sourceFile);
+    baseKey = Hash(reinterpret_cast<const char*>(&sourceFingerprint), sizeof(sourceFingerprint), baseKey);
 
-inline auto TraumaBuildSystem::v1::Experimental::Compile(const auto& sourceFile, const auto& compilerFlags, const auto& includes)
-{
-    static_assert(TypeTraits::IsStringLiteral<decltype(sourceFile)> || TypeTraits::IsString<decltype(sourceFile)>);
+    if (RestoreObject(baseKey, sourceOutput, dependencyFile, outputFile))
+    {
+        printf("Restoring %s from the object cache... (%s)\n", ToCStr(sourceFile), reason.c_str());
+        auto [output, outputSize] = ReadFile(outputFile);
+        if (output)
+        {
+            fwrite(output, 1, outputSize, stdout);
+            free(output);
+        }
+        return scheduler.add("", commandFile, commandHash);
+    }
 
-    printf("Building %s...\n", Helpers::ToCStr(sourceFile));
-    String sourceOutput = sourceFile + ".o";
-    Call("g++ -c" * compilerFlags * includes * "-o" * sourceOutput * sourceFile);
-    return sourceOutput;
+    printf("Building %s... (%s)\n", ToCStr(sourceFile), reason.c_str());
+    JobId job = scheduler.add(cmd, commandFile, commandHash);
+    scheduler.describe(job, "Compile", sourceFile);
+    scheduler.capture_output(job, outputFile);
+
+    CommandLine store;
+    store.add(ToHexString(baseKey)).add(dependencyFile).add(sourceOutput).add(outputFile);
+    scheduler.on_exit(job, StoreObject, store);
+    return job;
 }
 
 
 
-inline bool TraumaBuildSystem::v1::Experimental::Build(const auto& artifact, const auto& source, const auto& compilerFlags, const auto& linkerFlags, const auto& includes, const auto& libsPath, const auto& libs)
+template <typename Entry>
+inline Entry* TraumaBuildSystem::Helpers::FindEntry(Array<Entry>& table, uint64 pathHash)
 {
-    static_assert(TypeTraits::IsStringLiteral<decltype(artifact)> || TypeTraits::IsString<decltype(artifact)>);
-
-    printf("Building %s...\n", Helpers::ToCStr(artifact));
-    Call("g++" * linkerFlags * compilerFlags * includes * libsPath * "-o" * artifact * source * libs);
-
-    return true;
+    if (table.is_empty())
+        return nullptr;
+
+    size_t mask = table.size() - 1;
+    size_t index = pathHash & mask;
+    while (table[index].pathHash != 0 && table[index].pathHash != pathHash)
+        index = (index + 1) & mask;
+    return &table[index];
 }
 
 
 
-template <size_t Size>
-inline void TraumaBuildSystem::v1::Experimental::Call(const auto& cmd, String<Size>& output) // TODO: Rewrite.
+template <typename Entry>
+inline void TraumaBuildSystem::Helpers::StoreEntry(Array<Entry>& table, size_t& count, const Entry& entry)
 {
-    static_assert(TypeTraits::IsStringLiteral<decltype(cmd)> || TypeTraits::IsString<decltype(cmd)>);
-    static_assert(Size > 0);
-
-    static constexpr String redirection = "2>&1"; // Redirects stderr
-    // https://gcc.gnu.org/onlinedocs/gcc/Diagnostic-Message-Formatting-Options.html#Diagnostic-Message-Formatting-Options
-
-    FILE* pipe = popen(Helpers::ToCStr(cmd * redirection), "r"); assert(pipe);
-    if (!pipe) // TODO: Manage error.
-        return;
+    if ((count + 1) * 2 > table.size())
+    {
+        Array<Entry> oldTable = static_cast<Array<Entry>&&>(table);
+        size_t capacity = oldTable.size() < 256 ? 256 : oldTable.size() * 2;
+        table.reserve(capacity);
+        for (size_t i = 0; i < capacity; i++)
+            table.push({});
+        for (const Entry& oldEntry : oldTable)
+            if (oldEntry.pathHash != 0)
+                *FindEntry(table, oldEntry.pathHash) = oldEntry;
+    }
 
-    size_t c = fread(output.data(), 1, Size - 1, pipe);
-    output[c - 1] = '\0';
-    pclose(pipe);
+    Entry* slot = FindEntry(table, entry.pathHash);
+    if (slot->pathHash == 0)
+        count++;
+    *slot = entry;
 }
 
 
 
-inline void TraumaBuildSystem::v1::Experimental::Call(const auto& cmd)
+inline bool TraumaBuildSystem::Helpers::QueryFileStamp(const char* const filename, FileStamp& stamp)
 {
-    static_assert(TypeTraits::IsStringLiteral<decltype(cmd)> || TypeTraits::IsString<decltype(cmd)>);
+    if (!gFileSystemCache.enabled)
+        return GetFileStamp(filename, stamp);
+
+    char normalized[4096];
+    Platform::LockMutex(gFileSystemCache.mutex);
+    size_t length = NormalizePath(filename, normalized);
+    Platform::UnlockMutex(gFileSystemCache.mutex);
+    if (length == 0)
+        return GetFileStamp(filename, stamp);
+
+    uint64 pathHash = Hash(normalized, length) | 1;
+    Platform::LockMutex(gFileSystemCache.mutex);
+    FileSystemEntry* entry = FindEntry(gFileSystemCache.entries, pathHash);
+    bool cached = entry && entry->pathHash == pathHash && entry->known;
+    FileSystemEntry cachedEntry = cached ? *entry : FileSystemEntry{};
+    Platform::UnlockMutex(gFileSystemCache.mutex);
+
+    if (!cached)
+    {
+        cachedEntry = { pathHash, {}, false, true };
+        cachedEntry.exists = GetFileStamp(filename, cachedEntry.stamp);
+        Platform::LockMutex(gFileSystemCache.mutex);
+        StoreEntry(gFileSystemCache.entries, gFileSystemCache.entryCount, cachedEntry);
+        Platform::UnlockMutex(gFileSystemCache.mutex);
+    }
 
-    // TODO: system() is not safe, use something else.
-    if constexpr (TypeTraits::IsString<decltype(cmd)>)
-        system(cmd.c_str());
-    else
-        system(cmd);
+    stamp = cachedEntry.stamp;
+    return cachedEntry.exists;
 }
 
 
 
-inline void TraumaBuildSystem::v1::Experimental::ClearConsole()
+inline size_t TraumaBuildSystem::Helpers::NormalizePath(const char* const path, char (&normalized)[4096])
 {
-    #ifdef _WIN32
-        Call("cls");
-    #endif
-}
+    auto IsSeparator = [] (char c)
+    {
+        #ifdef _WIN32
+            return c == '/' || c == '\\';
+        #else
+            return c == '/';
+        #endif
+    };
 
+    // '..' can only be resolved without asking the file system while it removes components of the working directory, which has no symbolic links
+    // and exists. Elsewhere it could follow a link or step out of a missing directory, so such paths bypass the cache.
+    size_t length = 0;
+    size_t canonicalLength = 0;
+    bool cacheable = true;
+    auto AppendComponents = [&] (const char* p)
+    {
+        while (*p != '\0')
+        {
+            if (IsSeparator(*p))
+            {
+                p++;
+                continue;
+            }
 
+            const char* end = p;
+            while (*end != '\0' && !IsSeparator(*end))
+                end++;
 
-inline void TraumaBuildSystem::v1::Experimental::Print(const auto& message, ...)
-{
-    static_assert(TypeTraits::IsStringLiteral<decltype(message)> || TypeTraits::IsString<decltype(message)>);
+            size_t componentLength = static_cast<size_t>(end - p);
+            if (componentLength == 2 && p[0] == '.' && p[1] == '.')
+            {
+                cacheable = cacheable && length <= canonicalLength;
+                while (length > 0 && normalized[length - 1] != '/')
+                    length--;
+                if (length > 0)
+                    length--;
+                if (length < canonicalLength)
+                    canonicalLength = length;
+            }
+            else if (!(componentLength == 1 && p[0] == '.'))
+            {
+                cacheable = cacheable && length + componentLength + 1 < sizeof(normalized);
+                if (!cacheable)
+                    return;
+
+                normalized[length++] = '/';
+                for (size_t i = 0; i < componentLength; i++)
+                {
+                    // Windows paths are case insensitive.
+                    #ifdef _WIN32
+                        normalized[length++] = p[i] >= 'A' && p[i] <= 'Z' ? static_cast<char>(p[i] - 'A' + 'a') : p[i];
+                    #else
+                        normalized[length++] = p[i];
+                    #endif
+                }
+            }
+            p = end;
+        }
+    };
 
-    va_list args;
-    va_start(args, message);
-    if constexpr (TypeTraits::IsString<decltype(message)>)
-        vprintf(message.c_str(), args);
-    else
-        vprintf(message, args);
-    va_end(args);
+    #ifdef _WIN32
+        bool absolute = IsSeparator(path[0]) || (path[0] != '\0' && path[1] == ':');
+    #else
+        bool absolute = IsSeparator(path[0]);
+    #endif
+    if (!absolute)
+    {
+        AppendComponents(gThreadContext.directory.is_empty() ? gFileSystemCache.workingDirectory.c_str() : gThreadContext.directory.c_str());
+        canonicalLength = length;
+    }
+    AppendComponents(path);
+
+    if (!cacheable)
+        return 0;
+    if (length == 0)
+        normalized[length++] = '/';
+    normalized[length] = '\0';
+    return length;
 }
 
 
 
-inline void TraumaBuildSystem::v1::Experimental::Println(const auto& message, ...)
+inline void TraumaBuildSystem::Helpers::InvalidatePath(const char* const path)
 {
-    static_assert(TypeTraits::IsStringLiteral<decltype(message)> || TypeTraits::IsString<decltype(message)>);
+    if (!gFileSystemCache.enabled)
+        return;
 
-    va_list args;
-    va_start(args, message);
-    if constexpr (TypeTraits::IsString<decltype(message)>)
-        vprintf((message + "\n").c_str(), args);
-    else
+    // A path that can't be cached may still be another spelling of a cached one.
+    char normalized[4096];
+    Platform::LockMutex(gFileSystemCache.mutex);
+    size_t length = NormalizePath(path, normalized);
+    Platform::UnlockMutex(gFileSystemCache.mutex);
+    if (length == 0)
     {
-        vprintf(message, args);
-        printf("\n");
+        v1::Experimental::InvalidateFileSystemCache();
+        return;
     }
-    va_end(args);
+
+    uint64 pathHash = Hash(normalized, length) | 1;
+    Platform::LockMutex(gFileSystemCache.mutex);
+    if (FileSystemEntry* entry = FindEntry(gFileSystemCache.entries, pathHash);
+        entry && entry->pathHash == pathHash)
+        entry->known = false;
+
+    size_t parentLength = FindLastOf(normalized, "/");
+    uint64 parentHash = Hash(normalized, parentLength == 0 ? 1 : parentLength) | 1;
+    if (DirectoryListing* listing = FindEntry(gFileSystemCache.listings, parentHash);
+        listing && listing->pathHash == parentHash)
+    {
+        free(listing->names);
+        listing->names = nullptr;
+        listing->known = false;
+    }
+    Platform::UnlockMutex(gFileSystemCache.mutex);
 }
 
 
 
-inline void TraumaBuildSystem::v1::Experimental::Println()
-{
-    printf("\n");
-}
+#ifdef __linux__
+    inline void TraumaBuildSystem::Helpers::ListDirectory(const char* const directory, Array<char>& names)
+    {
+        char normalized[4096];
+        uint64 pathHash = 0;
+        if (gFileSystemCache.enabled)
+        {
+            Platform::LockMutex(gFileSystemCache.mutex);
+            size_t length = NormalizePath(directory, normalized);
+            pathHash = length > 0 ? Hash(normalized, length) | 1 : 0;
+            DirectoryListing* listing = FindEntry(gFileSystemCache.listings, pathHash);
+            bool cached = pathHash != 0 && listing && listing->pathHash == pathHash && listing->known;
+            if (cached)
+                names.append(listing->names, listing->size);
+            Platform::UnlockMutex(gFileSystemCache.mutex);
+            if (cached)
+                return;
+        }
 
+        size_t start = names.size();
+        int directoryFd = openat(gThreadContext.directoryFd, directory, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+        if (DIR* dir = directoryFd != -1 ? fdopendir(directoryFd) : nullptr)
+        {
+            while (const dirent* entry = readdir(dir))
+                if (strcmp(entry->d_name, ".") != 0 && strcmp(entry->d_name, "..") != 0)
+                    names.append(entry->d_name, strlen(entry->d_name) + 1);
+            closedir(dir);
+        }
+        else if (directoryFd != -1)
+            close(directoryFd);
 
+        if (gFileSystemCache.enabled && pathHash != 0)
+        {
+            DirectoryListing listing = { pathHash, static_cast<char*>(malloc(names.size() - start + 1)), names.size() - start, true };
+            memcpy(listing.names, names.data() + start, listing.size);
+            Platform::LockMutex(gFileSystemCache.mutex);
+            if (DirectoryListing* oldListing = FindEntry(gFileSystemCache.listings, pathHash);
+                oldListing && oldListing->pathHash == pathHash)
+                free(oldListing->names);
+            StoreEntry(gFileSystemCache.listings, gFileSystemCache.listingCount, listing);
+            Platform::UnlockMutex(gFileSystemCache.mutex);
+        }
+    }
+#endif
 
-inline auto TraumaBuildSystem::v1::Experimental::SVN::CurrentRevision()
-{
-    // FIXME: This currently returns the HEAD revision, not the the Working Copy's.
-    String<16> rev;
-    TraumaBuildSystem::v1::Experimental::Call("svn info -rHEAD --show-item revision", rev);
-    return rev;
-}
 
 
+#ifdef __linux__
+    inline bool TraumaBuildSystem::Helpers::DeleteTree(int parentFd, const char* const path)
+    {
+        // Anything but a directory, a symlink to one included, is a single entry.
+        int rootFd = openat(parentFd, path, O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+        if (rootFd == -1)
+            return (errno == ENOTDIR || errno == ELOOP) && unlinkat(parentFd, path, 0) == 0;
+
+        // Directories are named relative to the root, which is directories[0]. Their pending count is one for their own listing plus one per
+        // subdirectory not removed yet, whoever brings it to zero removes the directory and counts down its parent in turn.
+        struct Directory
+        {
+            SmallString                 path;
+            size_t                      parent                          = 0;
+            size_t                      pending                         = 1;
+        };
 
-inline auto TraumaBuildSystem::v1::Experimental::SVN::CurrentRevision(const auto& path)
-{
-    // FIXME: This currently returns the HEAD revision, not the the Working Copy's.
-    String<16> rev;
-    if (!IsValidPath(path))
-        return rev;
+        struct Walk
+        {
+            int                         rootFd                          = -1;
+            MutexHandle                 mutex                           = {};
+            ConditionHandle             condition                       = {};
+            Array<Directory>            directories;
+            Array<size_t>               queue;                                                          // Directories waiting to be listed.
+            bool                        done                            = false;                        // Set once everything under the root is removed.
+            bool                        success                         = true;
+        };
 
-    auto cwd = CurrentWorkingDirectory();
-    CurrentWorkingDirectory(path);
-    rev = CurrentRevision();
-    CurrentWorkingDirectory(cwd);
-    return rev;
-}
+        auto Work = [] (void* data)
+        {
+            Walk& walk = *static_cast<Walk*>(data);
+            Array<SmallString> subdirectories;
+            Platform::LockMutex(walk.mutex);
+            while (!walk.done)
+            {
+                if (walk.queue.is_empty())
+                {
+                    Platform::WaitCondition(walk.condition, walk.mutex);
+                    continue;
+                }
+
+                size_t index = walk.queue.back();
+                walk.queue.pop();
+                SmallString directory = walk.directories[index].path;
+                Platform::UnlockMutex(walk.mutex);
+
+                // Files go as they are listed, the entries of a directory can't be reordered while reading it anyway.
+                bool success = true;
+                subdirectories.clear();
+                int directoryFd = openat(walk.rootFd, directory, O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+                if (DIR* dir = directoryFd != -1 ? fdopendir(directoryFd) : nullptr)
+                {
+                    while (const dirent* entry = readdir(dir))
+                    {
+                        if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0)
+                            continue;
+
+                        struct stat entryStat;
+                        bool isDirectory = entry->d_type == DT_DIR || (entry->d_type == DT_UNKNOWN && fstatat(directoryFd, entry->d_name, &entryStat, AT_SYMLINK_NOFOLLOW) == 0 && S_ISDIR(entryStat.st_mode));
+                        if (isDirectory)
+                            subdirectories.push(index == 0 ? SmallString(entry->d_name) : directory / entry->d_name);
+                        else if (unlinkat(directoryFd, entry->d_name, 0) != 0 && errno != ENOENT)
+                            success = false;
+                    }
+                    closedir(dir);
+                }
+                else
+                {
+                    if (directoryFd != -1)
+                        close(directoryFd);
+                    success = false;
+                }
+
+                Platform::LockMutex(walk.mutex);
+                walk.success = walk.success && success;
+                for (SmallString& subdirectory : subdirectories)
+                {
+                    walk.directories.push(Directory{ static_cast<SmallString&&>(subdirectory), index });
+                    walk.queue.push(walk.directories.size() - 1);
+                    walk.directories[index].pending++;
+                }
+                if (!subdirectories.is_empty())
+                    Platform::WakeAll(walk.condition);
+
+                // A failed removal still counts down, its parent fails in turn and the walk ends.
+                for (size_t i = index; --walk.directories[i].pending == 0; i = walk.directories[i].parent)
+                {
+                    if (i == 0)
+                    {
+                        walk.done = true;
+                        Platform::WakeAll(walk.condition);
+                        break;
+                    }
+                    walk.success = unlinkat(walk.rootFd, walk.directories[i].path, AT_REMOVEDIR) == 0 && walk.success;
+                }
+            }
+            Platform::UnlockMutex(walk.mutex);
+        };
+
+        Walk walk;
+        walk.rootFd = rootFd;
+        walk.directories.push(Directory{ SmallString(".") });
+        walk.queue.push(0);
+
+        // Removals within a directory are serialized by the file system, so past a few threads more only add contention on the wide ones.
+        size_t workerCount = Platform::HardwareThreadCount() < 8 ? Platform::HardwareThreadCount() : 8;
+        Array<ThreadHandle> threads;
+        for (size_t i = 1; i < workerCount; i++)
+            threads.push(Platform::StartThread(Work, &walk));
+        Work(&walk);
+        for (ThreadHandle thread : threads)
+            Platform::JoinThread(thread);
+
+        close(rootFd);
+        return unlinkat(parentFd, path, AT_REMOVEDIR) == 0 && walk.success;
+    }
+#endif
 
 
 
-inline DynamicLibrary TraumaBuildSystem::Platform::LoadLibrary(const auto& filename)
+inline TraumaBuildSystem::SmallString TraumaBuildSystem::Helpers::TrashPath(const char* const path)
 {
-    static_assert(TypeTraits::IsStringLiteral<decltype(filename)> || TypeTraits::IsString<decltype(filename)>);
-
+    // Unique among the threads of every process deleting siblings of path.
     #ifdef _WIN32
-        auto winFilename = Helpers::ToWinPath(filename);
-        Windows::LPWSTR wStr = Helpers::ToWStr(winFilename);
-        Windows::HMODULE handle = Windows::LoadLibraryW(wStr);
-        free(wStr);
-        return handle;
+        uint64 unique[3] = { MonotonicTime(), reinterpret_cast<uint64>(&gThreadContext), Windows::GetCurrentProcessId() };
+    #elif defined(__linux__)
+        uint64 unique[3] = { MonotonicTime(), reinterpret_cast<uint64>(&gThreadContext), static_cast<uint64>(getpid()) };
     #endif
+
+    size_t length = Length(path);
+    while (length > 1 && (path[length - 1] == '/' || path[length - 1] == '\\'))
+        length--;
+    SmallString directory(path, length);
+    size_t index = FindLastOf(directory.c_str(), "\\/");
+
+    SmallString trash(directory.c_str(), index != InvalidStringIndex ? index + 1 : 0);
+    trash.append(".");
+    trash.append(directory.c_str() + (index != InvalidStringIndex ? index + 1 : 0));
+    trash.append(".deleting-");
+    trash.append(ToHexString(Hash(reinterpret_cast<const char*>(unique), sizeof(unique))));
+    return trash;
 }
 
 
 
-inline void TraumaBuildSystem::Platform::FreeLibrary(DynamicLibrary library)
+inline bool TraumaBuildSystem::Helpers::ListTree(const char* const directory, Array<SmallString>& files, Array<SmallString>& directories)
 {
     #ifdef _WIN32
-        Windows::FreeLibrary(library);
+        const auto invalidHandle = reinterpret_cast<Windows::HANDLE>(static_cast<Windows::LONG_PTR>(-1));
     #endif
-}
 
+    // Breadth first: the subdirectories found are listed in turn, once the current one is done.
+    size_t firstDirectory = directories.size();
+    for (size_t i = firstDirectory; i <= directories.size(); i++)
+    {
+        SmallString prefix = i == firstDirectory ? SmallString() : directories[i - 1] + "/";
+        SmallString path = i == firstDirectory ? SmallString(directory) : SmallString(directory) / directories[i - 1];
 
+        #ifdef _WIN32
+            auto wStr = ToWStr(ToWinPath(ToThreadPath(path / "*")));
+            Windows::WIN32_FIND_DATAW fileData = {};
+            Windows::HANDLE handle = Windows::FindFirstFileW(wStr, &fileData);
+            free(wStr);
+            if (handle == invalidHandle)
+            {
+                if (i == firstDirectory)
+                    return false;
+                continue;
+            }
 
-inline TraumaBuildSystem::Platform::VoidFnPtr TraumaBuildSystem::Platform::GetFunction(DynamicLibrary library, const char* const functionName)
-{
-    assert(functionName);
+            do
+            {
+                SmallString name = ToCStr(fileData.cFileName);
+                if (strcmp(name, ".") == 0 || strcmp(name, "..") == 0)
+                    continue;
+
+                if (!(fileData.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY))
+                    files.push(prefix + name);
+                else if (!(fileData.dwFileAttributes & FILE_ATTRIBUTE_REPARSE_POINT))
+                    directories.push(prefix + name);
+            } while (Windows::FindNextFileW(handle, &fileData));
+            Windows::FindClose(handle);
+        #elif defined(__linux__)
+            int directoryFd = openat(gThreadContext.directoryFd, path, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+            DIR* dir = directoryFd != -1 ? fdopendir(directoryFd) : nullptr;
+            if (!dir)
+            {
+                if (directoryFd != -1)
+                    close(directoryFd);
+                if (i == firstDirectory)
+                    return false;
+                continue;
+            }
 
-    #ifdef _WIN32
-        return reinterpret_cast<VoidFnPtr>(GetProcAddress(library, functionName));
-    #endif
+            while (const dirent* entry = readdir(dir))
+            {
+                if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0)
+                    continue;
+
+                struct stat entryStat;
+                if (entry->d_type == DT_DIR)
+                    directories.push(prefix + entry->d_name);
+                else if (entry->d_type == DT_REG || (fstatat(directoryFd, entry->d_name, &entryStat, 0) == 0 && S_ISREG(entryStat.st_mode)))
+                    files.push(prefix + entry->d_name);
+                else if (entry->d_type == DT_UNKNOWN && fstatat(directoryFd, entry->d_name, &entryStat, AT_SYMLINK_NOFOLLOW) == 0 && S_ISDIR(entryStat.st_mode))
+                    directories.push(prefix + entry->d_name);
+            }
+            closedir(dir);
+        #endif
+    }
+
+    return true;
 }
 
 
 
-template <typename FunctionPointer>
-inline FunctionPointer TraumaBuildSystem::Platform::GetFunction(DynamicLibrary library, const char* const functionName)
+inline bool TraumaBuildSystem::Helpers::SetModificationTime(const char* const filename, uint64 time)
 {
-    static_assert(TypeTraits::IsPointer<FunctionPointer>);
-    // static_assert(TypeTraits::IsFunction<std::remove_pointer_t<FunctionPointer>>); // FIXME
-    assert(functionName);
-    return reinterpret_cast<FunctionPointer>(GetFunction(library, functionName));
+    #ifdef _WIN32
+        auto wStr = ToWStr(ToWinPath(ToThreadPath(filename)));
+        Windows::HANDLE file = Windows::CreateFileW(wStr, FILE_WRITE_ATTRIBUTES, FILE_SHARE_READ | FILE_SHARE_WRITE, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+        free(wStr);
+        if (file == reinterpret_cast<Windows::HANDLE>(static_cast<Windows::LONG_PTR>(-1)))
+            return false;
+
+        Windows::FILETIME fileTime = { static_cast<Windows::DWORD>(time), static_cast<Windows::DWORD>(time >> 32) };
+        bool success = Windows::SetFileTime(file, nullptr, nullptr, &fileTime);
+        Windows::CloseHandle(file);
+    #elif defined(__linux__)
+        // The access time is left as it is.
+        timespec times[2] = { { 0, UTIME_OMIT }, { static_cast<time_t>(time / 1000000000ull), static_cast<long>(time % 1000000000ull) } };
+        bool success = utimensat(gThreadContext.directoryFd, filename, times, 0) == 0;
+    #endif
+
+    InvalidatePath(filename);
+    return success;
 }
@@ -10,11 +10,18 @@
 
 #pragma once
 
-using size_t = unsigned long long; static_assert(sizeof(size_t) == 8);
+using size_t = decltype(sizeof(0)); static_assert(sizeof(size_t) == 8);
 
 namespace TraumaBuildSystem
 {
     template <size_t> class String;
+    class Path;
+    class SmallString;
+
+    namespace v1::Experimental
+    {
+        class CommandLine;
+    }
 
     namespace TypeTraits
     {
@@ -82,6 +89,30 @@ namespace TraumaBuildSystem
             template <size_t StringSize>
             struct IsString<String<StringSize>&>                    { static constexpr bool Value = true; };
 
+            // - IsSmallString
+            template <typename T>
+            struct IsSmallString                                    { static constexpr bool Value = false; };
+            template <>
+            struct IsSmallString<const SmallString&>                { static constexpr bool Value = true; };
+            template <>
+            struct IsSmallString<SmallString&>                      { static constexpr bool Value = true; };
+
+            // - IsPath
+            template <typename T>
+            struct IsPath                                           { static constexpr bool Value = false; };
+            template <>
+            struct IsPath<const Path&>                              { static constexpr bool Value = true; };
+            template <>
+            struct IsPath<Path&>                                    { static constexpr bool Value = true; };
+
+            // - IsCommandLine
+            template <typename T>
+            struct IsCommandLine                                    { static constexpr bool Value = false; };
+            template <>
+            struct IsCommandLine<const v1::Experimental::CommandLine&> { static constexpr bool Value = true; };
+            template <>
+            struct IsCommandLine<v1::Experimental::CommandLine&>    { static constexpr bool Value = true; };
+
             // - IsPointer
             template <typename T>
             struct IsPointer                                        { static constexpr bool Value = false; };
@@ -107,6 +138,12 @@ namespace TraumaBuildSystem
         template <typename T>
         inline constexpr bool IsString                              = Implementation::IsString<T>::Value;
         template <typename T>
+        inline constexpr bool IsSmallString                         = Implementation::IsSmallString<T>::Value;
+        template <typename T>
+        inline constexpr bool IsPath                                = Implementation::IsPath<T>::Value;
+        template <typename T>
+        inline constexpr bool IsCommandLine                         = Implementation::IsCommandLine<T>::Value;
+        template <typename T>
         inline constexpr bool IsPointer                             = Implementation::IsPointer<T>::Value;
         template <typename T>
         inline constexpr bool IsFunction                            = Implementation::IsFunction<T>::Value;
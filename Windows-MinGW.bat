@@ -22,4 +22,7 @@ REM call g++ %BUILD_FLAGS% %DEFINES% %INCLUDES% %LIBS_PATH% -o tests.exe Sources
 call %BUILD_PATH%\GenerateTBS.exe
 del %BUILD_PATH%\GenerateTBS.exe
 
+REM Run as "Windows-MinGW.bat benchmarks" to also build the benchmark suite, see Sources\Benchmarks.cpp for its options.
+if "%1"=="benchmarks" call g++ %BUILD_FLAGS% %DEFINES% %INCLUDES% %LIBS_PATH% -o %BUILD_PATH%\benchmarks.exe Sources\Benchmarks.cpp %LIBS%
+
 endlocal